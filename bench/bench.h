@@ -0,0 +1,37 @@
+// Shared helpers for the list benchmarks.
+
+#ifndef DATASTRUCTURES_BENCH_H
+#define DATASTRUCTURES_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+static inline double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, so that every run sees the same inputs. */
+static inline uint64_t bench_rand(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/* Reads an optional element count from argv[1]. */
+static inline long bench_arg(int argc, char **argv, long fallback)
+{
+    if (argc < 2) return fallback;
+    long n = strtol(argv[1], NULL, 10);
+    return n > 0 ? n : fallback;
+}
+
+#endif //DATASTRUCTURES_BENCH_H
@@ -0,0 +1,65 @@
+// Builds and tears down many short-lived lists with malloc, a ListSlab and
+// a ListArena.
+//
+// Usage: bench_alloc [lists]
+
+#include "bench.h"
+#include "list_alloc.h"
+
+IMPORT_LIST(int, intList)
+
+#define BATCH 1000
+#define ELEMENTS 16
+
+typedef enum { MALLOC, SLAB, ARENA } Backend;
+
+static int run_batch(const ListAllocator *allocator, Backend backend,
+                     ListArena *arena)
+{
+    intList lists[BATCH];
+    for (int i = 0; i < BATCH; i++) {
+        lists[i] = intList_new_with(allocator);
+        if (!lists[i]) return MEMORY_ALLOCATION_ERR;
+        for (int j = 0; j < ELEMENTS; j++)
+            if (lists[i]->append(lists[i], j)) return MEMORY_ALLOCATION_ERR;
+    }
+    if (backend == ARENA) {
+        list_arena_reset(arena);
+        return 0;
+    }
+    for (int i = 0; i < BATCH; i++) lists[i]->destroy(lists[i]);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *names[] = { "malloc", "slab", "arena" };
+    long batches = bench_arg(argc, argv, 1000000) / BATCH;
+    if (batches < 1) batches = 1;
+
+    ListSlab slab;
+    ListArena arena;
+    list_slab_init(&slab);
+    list_arena_init(&arena, 0);
+    const ListAllocator *allocators[] = {
+        NULL, &slab.allocator, &arena.allocator
+    };
+
+    printf("%ld lists of %d ints\n", batches * BATCH, ELEMENTS);
+    for (int backend = MALLOC; backend <= ARENA; backend++) {
+        double start = bench_now();
+        for (long b = 0; b < batches; b++) {
+            if (run_batch(allocators[backend], (Backend) backend, &arena)) {
+                fprintf(stderr, "%s ran out of memory\n", names[backend]);
+                return MEMORY_ALLOCATION_ERR;
+            }
+        }
+        double elapsed = bench_now() - start;
+        printf("%-8s %8.1f ms %8.1f ns/list\n", names[backend], elapsed * 1e3,
+               elapsed / (batches * BATCH) * 1e9);
+    }
+
+    list_slab_destroy(&slab);
+    list_arena_destroy(&arena);
+    return 0;
+}
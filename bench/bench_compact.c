@@ -0,0 +1,116 @@
+// Builds and reads a million small lists through the function pointers,
+// through the inline direct API and as compact vecs held by value, and
+// reports the time per element and the bytes per list: the handle, plus
+// the header and element buffer each list asks the allocator for.
+//
+// Usage: bench_compact [lists]
+
+#include "bench.h"
+#include "list.h"
+
+IMPORT_LIST(int, intList)
+IMPORT_LIST_VEC(int, intList)
+
+enum { VTABLE, DIRECT, VEC, MODES };
+static const char *mode_names[MODES] = {
+    "function pointers", "direct inline", "compact vec"
+};
+
+/* Appends k elements to each of n lists, then sums them all. */
+static int run(int mode, ssize_t n, int k, int64_t *sum)
+{
+    intList *lists = mode != VEC ? calloc((size_t) n, sizeof(intList)) : NULL;
+    vec_intList *vecs = mode == VEC ? calloc((size_t) n, sizeof(vec_intList))
+                                    : NULL;
+    if (!lists && !vecs) return MEMORY_ALLOCATION_ERR;
+    int retCode = 0;
+
+    double start = bench_now();
+    for (ssize_t i = 0; i < n && !retCode; i++) {
+        if (mode == VEC) {
+            for (int j = 0; j < k && !retCode; j++)
+                retCode = intList_vec_push(&vecs[i], j);
+            continue;
+        }
+        intList list = lists[i] = LNEW(intList);
+        if (!list) {
+            retCode = MEMORY_ALLOCATION_ERR;
+        } else if (mode == VTABLE) {
+            for (int j = 0; j < k && !retCode; j++)
+                retCode = list->append(list, j);
+        } else {
+            for (int j = 0; j < k && !retCode; j++)
+                retCode = intList_push(list, j);
+        }
+    }
+    double built = bench_now();
+
+    size_t bytes = 0;
+    for (ssize_t i = 0; i < n && !retCode; i++) {
+        if (mode == VEC)
+            bytes += sizeof(vec_intList) + vecs[i].capacity * sizeof(int);
+        else
+            bytes += sizeof(intList) + sizeof(_intList)
+                     + lists[i]->capacity * sizeof(int);
+    }
+
+    int64_t total = 0;
+    for (ssize_t i = 0; i < n && !retCode; i++) {
+        if (mode == VEC) {
+            for (ssize_t j = 0; j < vecs[i].size; j++)
+                total += intList_vec_at(&vecs[i], j);
+        } else if (mode == VTABLE) {
+            intList list = lists[i];
+            for (ssize_t j = 0; j < list->len(list); j++) {
+                int x;
+                list->get(list, j, &x);
+                total += x;
+            }
+        } else {
+            for (ssize_t j = 0; j < lists[i]->size; j++)
+                total += intList_at(lists[i], j);
+        }
+    }
+    double read = bench_now();
+
+    if (!retCode) {
+        double elements = (double) n * k;
+        printf("  %-18s %9.2f %9.2f %12.1f\n", mode_names[mode],
+               (built - start) * 1e9 / elements,
+               (read - built) * 1e9 / elements,
+               (double) bytes / (double) n);
+    }
+    for (ssize_t i = 0; i < n; i++) {
+        if (vecs) intList_vec_free(&vecs[i]);
+        else intList_destroy(lists[i]);
+    }
+    free(lists);
+    free(vecs);
+    *sum = total;
+    return retCode;
+}
+
+int main(int argc, char **argv)
+{
+    ssize_t n = bench_arg(argc, argv, 1000000);
+    static const int lengths[] = { 1, 4, 16 };
+
+    printf("%ld lists; list header %zu bytes, vec %zu bytes\n", (long) n,
+           sizeof(_intList), sizeof(vec_intList));
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        int k = lengths[l];
+        int64_t expected = (int64_t) n * k * (k - 1) / 2;
+        printf("%d ints per list %18s %9s %12s\n", k, "build ns", "read ns",
+               "bytes/list");
+        for (int mode = 0; mode < MODES; mode++) {
+            int64_t sum = 0;
+            int retCode = run(mode, n, k, &sum);
+            if (retCode) return retCode;
+            if (sum != expected) {
+                fprintf(stderr, "%s: wrong sum\n", mode_names[mode]);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
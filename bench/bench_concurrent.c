@@ -0,0 +1,129 @@
+// Reports appends per second from 1, 2, 4 ... N producer threads, for a
+// mutex around an ordinary list's append, the lock-free concurrent list and
+// the sharded list, and checks that every element arrives exactly once.
+//
+// Usage: bench_concurrent [elements]
+
+#include "bench.h"
+#include "list_concurrent.h"
+
+IMPORT_LIST(int64_t, i64List)
+IMPORT_CONCURRENT_LIST(int64_t, i64List)
+
+enum { MUTEX, LOCK_FREE, SHARDED, MODES };
+static const char *mode_names[MODES] = { "mutex", "lock free", "sharded" };
+
+typedef struct {
+    int mode;
+    int64_t first;
+    int64_t count;
+    pthread_mutex_t *lock;
+    i64List list;
+    concurrent_i64List concurrent;
+    sharded_i64List sharded;
+    int retCode;
+} Producer;
+
+static void *produce(void *arg)
+{
+    Producer *p = (Producer *) arg;
+    int retCode = 0;
+    for (int64_t i = p->first; i < p->first + p->count && !retCode; i++) {
+        switch (p->mode) {
+        case MUTEX:
+            pthread_mutex_lock(p->lock);
+            retCode = p->list->append(p->list, i);
+            pthread_mutex_unlock(p->lock);
+            break;
+        case LOCK_FREE:
+            retCode = i64List_concurrent_append(p->concurrent, i);
+            break;
+        default:
+            retCode = i64List_sharded_append(p->sharded, i);
+        }
+    }
+    p->retCode = retCode;
+    return NULL;
+}
+
+/* Every value in [0, n) must appear exactly once. */
+static int check(i64List list, ssize_t n)
+{
+    if (list->len(list) != n) return 0;
+    char *seen = calloc((size_t) n, 1);
+    int ok = seen != NULL;
+    for (ssize_t i = 0; i < n && ok; i++) {
+        int64_t x = list->data[i];
+        ok = x >= 0 && x < n && !seen[x];
+        if (ok) seen[x] = 1;
+    }
+    free(seen);
+    return ok;
+}
+
+/* Returns appends per second, or a negative value on failure. */
+static double run(int mode, int threads, ssize_t n)
+{
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    Producer producers[threads];
+    pthread_t ids[threads];
+    i64List list = mode == MUTEX ? LNEW(i64List) : NULL;
+    concurrent_i64List concurrent
+            = mode == LOCK_FREE ? i64List_concurrent_new() : NULL;
+    sharded_i64List sharded
+            = mode == SHARDED ? i64List_sharded_new(threads) : NULL;
+    if (!list && !concurrent && !sharded) return -1;
+
+    double start = bench_now();
+    for (int t = 0; t < threads; t++) {
+        producers[t] = (Producer) {
+            .mode = mode, .first = n * t / threads,
+            .count = n * (t + 1) / threads - n * t / threads,
+            .lock = &lock, .list = list, .concurrent = concurrent,
+            .sharded = sharded,
+        };
+        pthread_create(&ids[t], NULL, produce, &producers[t]);
+    }
+    int retCode = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+        if (producers[t].retCode) retCode = producers[t].retCode;
+    }
+    double elapsed = bench_now() - start;
+
+    if (concurrent) {
+        if (!retCode) retCode = i64List_concurrent_freeze(concurrent, &list);
+        i64List_concurrent_destroy(concurrent);
+    } else if (sharded) {
+        if (!retCode) retCode = i64List_sharded_collect(sharded, &list);
+        i64List_sharded_destroy(sharded);
+    }
+    int ok = !retCode && check(list, n);
+    if (list) list->destroy(list);
+    if (!ok) fprintf(stderr, "%s, %d threads: wrong result\n",
+                     mode_names[mode], threads);
+    return ok ? n / elapsed : -1;
+}
+
+int main(int argc, char **argv)
+{
+    ssize_t n = bench_arg(argc, argv, 1L << 24);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 4) cpus = 4;
+
+    printf("%ld appends, Mappends/s\n", (long) n);
+    printf("%8s %12s %12s %12s\n", "threads", mode_names[MUTEX],
+           mode_names[LOCK_FREE], mode_names[SHARDED]);
+    for (long threads = 1; ; threads *= 2) {
+        if (threads > cpus) threads = cpus;
+        printf("%8ld", threads);
+        for (int mode = 0; mode < MODES; mode++) {
+            double rate = run(mode, (int) threads, n);
+            if (rate < 0) return 1;
+            printf(" %12.1f", rate / 1e6);
+        }
+        printf("\n");
+        if (threads == cpus) break;
+    }
+    return 0;
+}
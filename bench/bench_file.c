@@ -0,0 +1,123 @@
+// Compares rebuilding a list through append with loading and mapping a
+// saved copy, and checks that every path gives back the same elements.
+//
+// Usage: bench_file [elements]
+
+#include "bench.h"
+#include "list_file.h"
+
+IMPORT_LIST(int64_t, i64List)
+IMPORT_LIST_FILE(int64_t, i64List)
+
+#define PATH "bench_file.dslist"
+
+static int same(i64List a, i64List b)
+{
+    return a->len(a) == b->len(b)
+           && !memcmp(a->data, b->data, a->len(a) * sizeof(int64_t));
+}
+
+static int fail(const char *what, int retCode)
+{
+    fprintf(stderr, "%s failed (%d)\n", what, retCode);
+    unlink(PATH);
+    return retCode ? retCode : 1;
+}
+
+int main(int argc, char **argv)
+{
+    ssize_t n = bench_arg(argc, argv, 32L << 20);
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    int retCode;
+    printf("%ld int64_t (%ld MB)\n", (long) n, (long) (n * 8 >> 20));
+
+    double start = bench_now();
+    i64List list = LNEW(i64List);
+    if (!list) return MEMORY_ALLOCATION_ERR;
+    for (ssize_t i = 0; i < n; i++)
+        if ((retCode = list->append(list, (int64_t) bench_rand(&seed))))
+            return fail("append", retCode);
+    printf("  %-24s %10.2f ms\n", "rebuild with append",
+           (bench_now() - start) * 1e3);
+
+    start = bench_now();
+    if ((retCode = i64List_save(list, PATH))) return fail("save", retCode);
+    printf("  %-24s %10.2f ms\n", "save", (bench_now() - start) * 1e3);
+
+    i64List loaded;
+    start = bench_now();
+    if ((retCode = i64List_load(PATH, NULL, &loaded)))
+        return fail("load", retCode);
+    printf("  %-24s %10.2f ms\n", "load", (bench_now() - start) * 1e3);
+    if (!same(list, loaded)) return fail("load round trip", 0);
+    loaded->destroy(loaded);
+
+    static const struct { const char *name; int mode; } opens[] = {
+        { "open read only", LIST_FILE_READONLY },
+        { "open copy on write", LIST_FILE_COPY_ON_WRITE },
+        { "open and verify", LIST_FILE_READONLY | LIST_FILE_VERIFY },
+    };
+    for (int i = 0; i < 3; i++) {
+        i64List mapped;
+        start = bench_now();
+        if ((retCode = i64List_open(PATH, opens[i].mode, &mapped)))
+            return fail(opens[i].name, retCode);
+        printf("  %-24s %10.2f ms\n", opens[i].name,
+               (bench_now() - start) * 1e3);
+        if (!same(list, mapped)) return fail("open round trip", 0);
+
+        /* Copy on write lists can be changed, and grow onto the heap. */
+        if (opens[i].mode == LIST_FILE_COPY_ON_WRITE) {
+            if ((retCode = mapped->set(mapped, 0, -1))
+                || (retCode = mapped->append(mapped, 7)))
+                return fail("changing a mapped list", retCode);
+            if (mapped->data[0] != -1 || mapped->data[n] != 7
+                || memcmp(&mapped->data[1], &list->data[1],
+                          (n - 1) * sizeof(int64_t)))
+                return fail("changing a mapped list", 0);
+        }
+
+        /* A slice shares the allocator and must outlive its parent. */
+        i64List slice = mapped->slice(mapped, 0, n - 1, 1);
+        if (!slice) return fail("slicing a mapped list", 0);
+        mapped->destroy(mapped);
+        if ((retCode = slice->append(slice, 7)))
+            return fail("growing a slice of a mapped list", retCode);
+        if (slice->data[n] != 7
+            || memcmp(&slice->data[1], &list->data[1],
+                      (n - 1) * sizeof(int64_t)))
+            return fail("growing a slice of a mapped list", 0);
+        slice->destroy(slice);
+    }
+
+    /* Saving an opened list back over its own file must not lose it. */
+    i64List edited, reloaded;
+    if ((retCode = i64List_open(PATH, LIST_FILE_COPY_ON_WRITE, &edited)))
+        return fail("open before saving back", retCode);
+    if ((retCode = edited->set(edited, 0, 42))
+        || (retCode = i64List_save(edited, PATH)))
+        return fail("saving a mapped list over its file", retCode);
+    if ((retCode = i64List_load(PATH, NULL, &reloaded)))
+        return fail("load after saving back", retCode);
+    if (!same(edited, reloaded) || reloaded->data[0] != 42
+        || memcmp(&reloaded->data[1], &list->data[1],
+                  (n - 1) * sizeof(int64_t)))
+        return fail("saving a mapped list over its file", 0);
+    edited->destroy(edited);
+    reloaded->destroy(reloaded);
+
+    /* A flipped byte must be caught by load and by a verified open. */
+    int fd = open(PATH, O_RDWR);
+    char byte = 0x5A;
+    if (fd < 0 || pwrite(fd, &byte, 1, sizeof(ListFileHeader) + 3) != 1)
+        return fail("corrupting the file", 0);
+    close(fd);
+    i64List corrupt;
+    if (i64List_load(PATH, NULL, &corrupt) != FILE_FORMAT_ERR
+        || i64List_open(PATH, LIST_FILE_VERIFY, &corrupt) != FILE_FORMAT_ERR)
+        return fail("detecting corruption", 0);
+
+    list->destroy(list);
+    unlink(PATH);
+    return 0;
+}
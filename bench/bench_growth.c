@@ -0,0 +1,144 @@
+// Counts allocator calls and time for append/pop churn, comparing the old
+// resize (a realloc on every call, fixed doubling and halving) with the
+// growth policy, reserve and shrink hysteresis.
+//
+// Usage: bench_growth [operations]
+
+#include "bench.h"
+#include "list.h"
+
+IMPORT_LIST(int, intList)
+
+static long reallocs;
+
+static void *counting_allocate(void *ctx, size_t size)
+{
+    (void) ctx;
+    reallocs++;
+    return malloc(size);
+}
+
+static void *counting_reallocate(void *ctx, void *ptr, size_t old_size,
+                                 size_t new_size)
+{
+    (void) ctx;
+    (void) old_size;
+    reallocs++;
+    return realloc(ptr, new_size);
+}
+
+static void counting_release(void *ctx, void *ptr, size_t size)
+{
+    (void) ctx;
+    (void) size;
+    free(ptr);
+}
+
+static const ListAllocator counting = {
+    counting_allocate, counting_reallocate, counting_release, NULL
+};
+
+/* L##_resize as it was: always reallocates, even to the same capacity. */
+static int legacy_resize(intList list)
+{
+    ssize_t new_capacity = list->capacity;
+    if (list->size >= list->capacity) {
+        while (new_capacity <= list->size)
+            new_capacity = new_capacity ? new_capacity * 2 : 1;
+    } else if (list->size < list->capacity / 4) {
+        while (new_capacity > (list->size * 4)) new_capacity /= 2;
+    }
+    int *new_data = (int *) list_realloc(list->allocator, list->data,
+                                         list->capacity * sizeof(int),
+                                         new_capacity * sizeof(int));
+    if (!new_data) return MEMORY_ALLOCATION_ERR;
+    list->data = new_data;
+    list->capacity = new_capacity;
+    return 0;
+}
+
+static int legacy_append(intList list, int element)
+{
+    if (legacy_resize(list)) return MEMORY_ALLOCATION_ERR;
+    list->data[list->size++] = element;
+    return 0;
+}
+
+static int legacy_pop(intList list)
+{
+    list->size--;
+    return legacy_resize(list);
+}
+
+static int current_pop(intList list)
+{
+    int value;
+    return list->pop(list, list->size - 1, &value);
+}
+
+static void report(const char *name, double elapsed)
+{
+    printf("  %-30s %10ld reallocs %10.2f ms\n", name, reallocs,
+           elapsed * 1e3);
+    reallocs = 0;
+}
+
+int main(int argc, char **argv)
+{
+    long ops = bench_arg(argc, argv, 10000000);
+    int retCode = 0;
+
+    /* Fill to exactly a power of two so the next append has to grow. */
+    const ssize_t base = 1024;
+    printf("push/pop churn at a capacity boundary, %ld operations\n", ops);
+    for (int mode = 0; mode < 3; mode++) {
+        intList list = intList_new_with(&counting);
+        if (!list) return MEMORY_ALLOCATION_ERR;
+        if (mode == 2) list->growth.shrink = 0;
+        for (ssize_t i = 0; i < base; i++)
+            retCode |= mode ? list->append(list, 0) : legacy_append(list, 0);
+        reallocs = 0;
+
+        double start = bench_now();
+        for (long i = 0; i < ops / 2; i++) {
+            if (mode) {
+                retCode |= list->append(list, (int) i);
+                retCode |= current_pop(list);
+            } else {
+                retCode |= legacy_append(list, (int) i);
+                retCode |= legacy_pop(list);
+            }
+        }
+        static const char *names[] = {
+            "legacy resize", "growth policy", "growth policy, no shrink"
+        };
+        report(names[mode], bench_now() - start);
+        list->destroy(list);
+    }
+
+    printf("append %ld then pop all but one\n", ops);
+    for (int mode = 0; mode < 4; mode++) {
+        intList list = intList_new_with(&counting);
+        if (!list) return MEMORY_ALLOCATION_ERR;
+        reallocs = 0;
+        double start = bench_now();
+        if (mode == 2) list->growth.shrink = 0;
+        if (mode >= 2) retCode |= list->reserve(list, ops);
+        for (long i = 0; i < ops; i++)
+            retCode |= mode ? list->append(list, (int) i)
+                            : legacy_append(list, (int) i);
+        while (list->size > 1)
+            retCode |= mode ? current_pop(list) : legacy_pop(list);
+        static const char *names[] = {
+            "legacy resize", "growth policy", "reserve, no shrink",
+            "reserve, shrink"
+        };
+        /* Popping must not give back reserved capacity. */
+        if (mode >= 2 && list->capacity < ops) retCode = 1;
+        report(names[mode], bench_now() - start);
+        list->destroy(list);
+    }
+
+    if (retCode) fprintf(stderr, "an operation failed\n");
+    return retCode;
+}
@@ -0,0 +1,211 @@
+// Times every list operation for several element sizes and list lengths.
+// Built with LIST_STATS, it also reports the reallocs, bytes moved by
+// memmove and comparisons each operation made. Shuffles use a fixed seed,
+// so every run sees the same data.
+//
+// Usage: bench_ops [longest length]
+
+#include "bench.h"
+#include "list.h"
+
+typedef struct {
+    int64_t key;
+    char payload[56];
+} Wide;
+
+static int32_t make_i32(uint64_t x) { return (int32_t) x; }
+static int64_t key_i32(int32_t x) { return x; }
+static int64_t make_i64(uint64_t x) { return (int64_t) x; }
+static int64_t key_i64(int64_t x) { return x; }
+
+static Wide make_wide(uint64_t x)
+{
+    Wide w;
+    w.key = (int64_t) x;
+    memset(w.payload, (int) (x & 0xff), sizeof(w.payload));
+    return w;
+}
+
+static int64_t key_wide(Wide x) { return x.key; }
+
+IMPORT_LIST(int32_t, i32List)
+IMPORT_LIST(int64_t, i64List)
+IMPORT_LIST(Wide, wideList)
+
+static void report(const char *name, long calls, double start,
+                   ListStats before, ListStats after)
+{
+    double elapsed = bench_now() - start;
+    printf("  %-14s %10ld %12.1f", name, calls, elapsed * 1e9 / calls);
+#ifdef LIST_STATS
+    printf(" %10ld %14ld %14ld", (long) (after.reallocs - before.reallocs),
+           (long) (after.bytes_moved - before.bytes_moved),
+           (long) (after.comparisons - before.comparisons));
+#else
+    (void) before;
+    (void) after;
+#endif
+    printf("\n");
+}
+
+/* Unsigned, so that summing random keys wraps instead of overflowing. */
+static volatile uint64_t sink;
+
+/*
+ * Runs the block that follows once, between a snapshot of list's counters
+ * and the report of its time and counters.
+ */
+#define BENCH_OP(L, name, list, calls)                                         \
+    for (int once = (before = L##_stats(list), start = bench_now(), 1); once;  \
+         once = 0, report(name, (long) (calls), start, before,                 \
+                          L##_stats(list)))
+
+#define BENCH_OPS(T, L, MAKE, KEY)                                             \
+static uint64_t L##_visited;                                                   \
+                                                                               \
+static int L##_compare(const void *a, const void *b)                           \
+{                                                                              \
+    int64_t x = KEY(*(const T *) a);                                           \
+    int64_t y = KEY(*(const T *) b);                                           \
+    return (x > y) - (x < y);                                                  \
+}                                                                              \
+                                                                               \
+static int L##_visit(L list, ssize_t index)                                    \
+{                                                                              \
+    L##_visited += (uint64_t) KEY(list->data[index]);                          \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+static int L##_is_odd(const T *x, void *ctx)                                   \
+{                                                                              \
+    (void) ctx;                                                                \
+    return (int) (KEY(*x) & 1);                                                \
+}                                                                              \
+                                                                               \
+static int L##_bench(ssize_t n)                                                \
+{                                                                              \
+    L list = LNEW(L);                                                          \
+    L other = LNEW(L);                                                         \
+    if (!list || !other) return MEMORY_ALLOCATION_ERR;                         \
+    ssize_t few = n < 1000 ? n : 1000;                                         \
+    ssize_t repeats = n < (1 << 20) ? (1 << 20) / n : 1;                       \
+    ListRng rng;                                                               \
+    list_rng_seed(&rng, 42);                                                   \
+    int retCode = 0;                                                           \
+    ListStats before;                                                          \
+    double start;                                                              \
+    T x;                                                                       \
+                                                                               \
+    printf("%s, %zu byte elements, length %ld\n", #L, sizeof(T), (long) n);    \
+                                                                               \
+    BENCH_OP(L, "append", list, n) {                                           \
+        for (ssize_t i = 0; i < n; i++)                                        \
+            retCode |= list->append(list, MAKE(list_rng_next(&rng)));          \
+    }                                                                          \
+    BENCH_OP(L, "push", other, n) {                                            \
+        for (ssize_t i = 0; i < n; i++)                                        \
+            retCode |= L##_push(other, MAKE(i));                               \
+    }                                                                          \
+    BENCH_OP(L, "get", list, n) {                                              \
+        for (ssize_t i = 0; i < n; i++) {                                      \
+            retCode |= list->get(list, i, &x);                                 \
+            sink += (uint64_t) KEY(x);                                         \
+        }                                                                      \
+    }                                                                          \
+    BENCH_OP(L, "set", other, n) {                                             \
+        for (ssize_t i = 0; i < n; i++)                                        \
+            retCode |= other->set(other, i, MAKE(n - i));                      \
+    }                                                                          \
+    BENCH_OP(L, "find", list, repeats) {                                       \
+        for (ssize_t r = 0; r < repeats; r++)                                  \
+            sink += (uint64_t) list->find(list, MAKE(r), L##_compare);         \
+    }                                                                          \
+    BENCH_OP(L, "foreach", list, repeats) {                                    \
+        for (ssize_t r = 0; r < repeats; r++)                                  \
+            retCode |= list->foreach(list, L##_visit);                         \
+        sink += L##_visited;                                                   \
+    }                                                                          \
+    BENCH_OP(L, "reverse", list, repeats) {                                    \
+        for (ssize_t r = 0; r < repeats; r++) list->reverse(list);             \
+    }                                                                          \
+    BENCH_OP(L, "sort", list, 1) {                                             \
+        list->sort(list, 0, n - 1, L##_compare);                               \
+    }                                                                          \
+    for (ssize_t i = 1; i < n; i++)                                            \
+        if (KEY(list->data[i - 1]) > KEY(list->data[i])) retCode = 1;          \
+    BENCH_OP(L, "shuffle", list, 1) {                                          \
+        if (n > 1) retCode |= L##_shuffle_with(list, 0, n - 1, &rng);          \
+    }                                                                          \
+    BENCH_OP(L, "slice", list, repeats) {                                      \
+        for (ssize_t r = 0; r < repeats; r++) {                                \
+            L copy = list->slice(list, 0, n - 1, 1);                           \
+            if (!copy) retCode = MEMORY_ALLOCATION_ERR;                        \
+            L##_destroy(copy);                                                 \
+        }                                                                      \
+    }                                                                          \
+    BENCH_OP(L, "insert", list, few) {                                         \
+        for (ssize_t i = 0; i < few; i++)                                      \
+            retCode |= list->insert(list, list->size / 2, MAKE(i));            \
+    }                                                                          \
+    BENCH_OP(L, "pop", list, few) {                                            \
+        for (ssize_t i = 0; i < few; i++)                                      \
+            retCode |= list->pop(list, list->size / 2, &x);                    \
+    }                                                                          \
+    L##_clear(other);                                                          \
+    BENCH_OP(L, "append_n", other, repeats) {                                  \
+        for (ssize_t r = 0; r < repeats; r++) {                                \
+            other->size = 0;                                                   \
+            retCode |= other->append_n(other, list->data, n);                  \
+        }                                                                      \
+    }                                                                          \
+    BENCH_OP(L, "insert_range", other, 16) {                                   \
+        for (int r = 0; r < 16; r++)                                           \
+            retCode |= other->insert_range(other, other->size / 2,             \
+                                           list->data, few);                   \
+    }                                                                          \
+    BENCH_OP(L, "erase_range", other, 16) {                                    \
+        for (int r = 0; r < 16; r++)                                           \
+            retCode |= other->erase_range(other, other->size / 2,              \
+                                          other->size / 2 + few - 1);          \
+    }                                                                          \
+    BENCH_OP(L, "remove_if", other, 1) {                                       \
+        retCode |= other->remove_if(other, L##_is_odd, NULL);                  \
+    }                                                                          \
+    BENCH_OP(L, "reserve", other, 1) {                                         \
+        retCode |= other->reserve(other, 4 * n);                               \
+    }                                                                          \
+    BENCH_OP(L, "shrink_to_fit", other, 1) {                                   \
+        retCode |= other->shrink_to_fit(other);                                \
+    }                                                                          \
+    BENCH_OP(L, "clear", list, 1) {                                            \
+        list->clear(list);                                                     \
+    }                                                                          \
+                                                                               \
+    list->destroy(list);                                                       \
+    other->destroy(other);                                                     \
+    if (retCode) fprintf(stderr, "%s: an operation failed\n", #L);             \
+    return retCode;                                                            \
+}
+
+BENCH_OPS(int32_t, i32List, make_i32, key_i32)
+BENCH_OPS(int64_t, i64List, make_i64, key_i64)
+BENCH_OPS(Wide, wideList, make_wide, key_wide)
+
+int main(int argc, char **argv)
+{
+    ssize_t longest = bench_arg(argc, argv, 1L << 20);
+    static const ssize_t lengths[] = { 16, 1024, 65536, 1L << 20 };
+
+    printf("  %-14s %10s %12s", "operation", "calls", "ns/call");
+#ifdef LIST_STATS
+    printf(" %10s %14s %14s", "reallocs", "bytes moved", "comparisons");
+#endif
+    printf("\n");
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        ssize_t n = lengths[l] < longest ? lengths[l] : longest;
+        if (i32List_bench(n) || i64List_bench(n) || wideList_bench(n))
+            return 1;
+        if (n == longest) break;
+    }
+    return 0;
+}
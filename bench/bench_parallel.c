@@ -0,0 +1,88 @@
+// Reports psort, pfind and pforeach throughput at 1, 2, 4 ... N threads.
+//
+// Usage: bench_parallel [elements]
+
+#include "bench.h"
+#include "list_parallel.h"
+
+IMPORT_LIST(int, intList)
+IMPORT_LIST_PARALLEL(int, intList)
+
+static int compare_ints(const void *a, const void *b)
+{
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+static int sum_range(intList list, ssize_t begin, ssize_t end, void *ctx)
+{
+    int64_t sum = 0;
+    for (ssize_t i = begin; i < end; i++) sum += list->data[i];
+    atomic_fetch_add((_Atomic int64_t *) ctx, sum);
+    return 0;
+}
+
+static void fill(intList list)
+{
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (ssize_t i = 0; i < list->len(list); i++)
+        list->data[i] = (int) (bench_rand(&seed) >> 33);
+}
+
+int main(int argc, char **argv)
+{
+    ssize_t n = bench_arg(argc, argv, 1L << 24);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+
+    intList list = LNEW(intList);
+    if (!list) return MEMORY_ALLOCATION_ERR;
+    for (ssize_t i = 0; i < n; i++) {
+        if (list->append(list, 0)) {
+            list->destroy(list);
+            return MEMORY_ALLOCATION_ERR;
+        }
+    }
+
+    printf("%ld ints, Melem/s\n", (long) n);
+    printf("%8s %12s %12s %12s\n", "threads", "psort", "pfind", "pforeach");
+
+    for (long threads = 1; ; threads *= 2) {
+        if (threads > cpus) threads = cpus;
+        ListPool *pool = list_pool_new((int) threads);
+        if (!pool) break;
+
+        fill(list);
+        double start = bench_now();
+        int retCode = intList_psort(list, 0, n - 1, compare_ints, pool);
+        double sort_time = bench_now() - start;
+        for (ssize_t i = 1; i < n && !retCode; i++)
+            if (list->data[i - 1] > list->data[i]) retCode = 1;
+
+        /* -1 is never stored, so the whole list is scanned. */
+        start = bench_now();
+        ssize_t found = intList_pfind(list, -1, compare_ints, pool);
+        double find_time = bench_now() - start;
+
+        _Atomic int64_t sum = 0;
+        start = bench_now();
+        retCode |= intList_pforeach(list, sum_range, &sum, 0, pool);
+        double foreach_time = bench_now() - start;
+
+        list_pool_destroy(pool);
+        if (retCode || found != -1) {
+            fprintf(stderr, "parallel results are wrong\n");
+            list->destroy(list);
+            return 1;
+        }
+
+        printf("%8ld %12.1f %12.1f %12.1f\n", threads,
+               n / sort_time * 1e-6, n / find_time * 1e-6,
+               n / foreach_time * 1e-6);
+        if (threads == cpus) break;
+    }
+
+    list->destroy(list);
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Times append_n, extend, insert_range, erase_range and remove_if on lists
+// made with malloc, a ListSlab and a ListArena, with the source elements
+// taken from the list being changed. Every result is checked against the
+// elements it should hold, and a fourth allocator that always moves and
+// scribbles over the old block makes a stale source pointer show up.
+//
+// Usage: bench_ranges [elements]
+
+#include "bench.h"
+#include "list_alloc.h"
+
+IMPORT_LIST(int, intList)
+
+enum { EXTEND, APPEND_N, INSERT_MIDDLE, INSERT_END, ERASE_ALL, REMOVE_IF,
+       CASES };
+static const char *case_names[CASES] = {
+    "extend(l, l)", "append_n", "insert middle", "insert end", "erase all",
+    "remove_if"
+};
+
+static void expect(int ok, const char *what)
+{
+    if (ok) return;
+    fprintf(stderr, "%s gave the wrong elements\n", what);
+    exit(1);
+}
+
+/* Makes list hold 0, 1, ..., n - 1. */
+static void fill(intList list, ssize_t n)
+{
+    list->clear(list);
+    for (ssize_t i = 0; i < n; i++)
+        expect(!list->append(list, (int) i), "append");
+}
+
+/* Called through a volatile pointer so the store before free is kept. */
+static void *(*volatile scribble)(void *, int, size_t) = memset;
+
+static void *moving_allocate(void *ctx, size_t size)
+{
+    (void) ctx;
+    return malloc(size);
+}
+
+static void *moving_reallocate(void *ctx, void *ptr, size_t old_size,
+                               size_t new_size)
+{
+    (void) ctx;
+    void *result = malloc(new_size);
+    if (!result) return NULL;
+    if (ptr) {
+        memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+        scribble(ptr, 0xA5, old_size);
+        free(ptr);
+    }
+    return result;
+}
+
+static void moving_release(void *ctx, void *ptr, size_t size)
+{
+    (void) ctx;
+    if (ptr) scribble(ptr, 0xA5, size);
+    free(ptr);
+}
+
+static int is_odd(const int *x, void *ctx)
+{
+    (void) ctx;
+    return *x & 1;
+}
+
+/* Runs one case on 0, 1, ..., n - 1 and returns how long it took. */
+static double run(intList list, int which, ssize_t n)
+{
+    ssize_t k = n / 4, index = n / 2, count = n / 2;
+    fill(list, n);
+
+    double start = bench_now();
+    int retCode = 0;
+    switch (which) {
+        case EXTEND: retCode = list->extend(list, list); break;
+        case APPEND_N:
+            retCode = list->append_n(list, list->data + 1, n - 1);
+            break;
+        /* The source straddles the insertion point. */
+        case INSERT_MIDDLE:
+            retCode = list->insert_range(list, index, list->data + k, count);
+            break;
+        case INSERT_END:
+            retCode = list->insert_range(list, n, list->data + k, n - k);
+            break;
+        case ERASE_ALL: retCode = list->erase_range(list, 0, n - 1); break;
+        default: retCode = list->remove_if(list, is_odd, NULL); break;
+    }
+    double elapsed = bench_now() - start;
+    expect(!retCode, case_names[which]);
+
+    const int *data = list->data;
+    ssize_t size = list->size;
+    switch (which) {
+        case EXTEND:
+            expect(size == 2 * n, case_names[which]);
+            for (ssize_t i = 0; i < size; i++)
+                expect(data[i] == i % n, case_names[which]);
+            break;
+        case APPEND_N:
+            expect(size == 2 * n - 1, case_names[which]);
+            for (ssize_t i = 0; i < size; i++)
+                expect(data[i] == (i < n ? i : i - n + 1), case_names[which]);
+            break;
+        case INSERT_MIDDLE:
+            expect(size == n + count, case_names[which]);
+            for (ssize_t i = 0; i < size; i++)
+                expect(data[i] == (i < index ? i
+                                   : i < index + count ? k + i - index
+                                   : i - count), case_names[which]);
+            break;
+        case INSERT_END:
+            expect(size == 2 * n - k, case_names[which]);
+            for (ssize_t i = 0; i < size; i++)
+                expect(data[i] == (i < n ? i : k + i - n), case_names[which]);
+            break;
+        case ERASE_ALL:
+            expect(size == 0, case_names[which]);
+            expect(!list->append(list, 7) && list->data[0] == 7,
+                   "append after erasing everything");
+            break;
+        default:
+            expect(size == (n + 1) / 2, case_names[which]);
+            for (ssize_t i = 0; i < size; i++)
+                expect(data[i] == 2 * i, case_names[which]);
+            break;
+    }
+    return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *names[] = { "malloc", "slab", "arena", "moving" };
+    ssize_t n = bench_arg(argc, argv, 1L << 20);
+
+    ListSlab slab;
+    ListArena arena;
+    list_slab_init(&slab);
+    list_arena_init(&arena, 0);
+    ListAllocator moving = {
+        moving_allocate, moving_reallocate, moving_release, NULL
+    };
+    const ListAllocator *allocators[] = {
+        NULL, &slab.allocator, &arena.allocator, &moving
+    };
+
+    printf("%ld ints, ms per call\n%-8s", (long) n, "");
+    for (int which = 0; which < CASES; which++)
+        printf(" %14s", case_names[which]);
+    printf("\n");
+    for (int backend = 0; backend < 4; backend++) {
+        intList list = intList_new_with(allocators[backend]);
+        if (!list) return MEMORY_ALLOCATION_ERR;
+        printf("%-8s", names[backend]);
+        for (int which = 0; which < CASES; which++)
+            printf(" %14.3f", run(list, which, n) * 1e3);
+        printf("\n");
+        list->destroy(list);
+    }
+
+    list_arena_destroy(&arena);
+    list_slab_destroy(&slab);
+    return 0;
+}
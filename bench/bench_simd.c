@@ -0,0 +1,168 @@
+// Measures the SIMD search and reduction kernels in GB/s against a find
+// through compare_func, for int, float and uint64_t lists, and checks every
+// kernel against a plain loop on both the dispatched and the base path.
+//
+// Usage: bench_simd [bytes per list]
+
+#include "bench.h"
+#include "list_simd.h"
+
+IMPORT_LIST(int, intList)
+IMPORT_LIST_SIMD(int, intList, int64_t)
+IMPORT_LIST(float, floatList)
+IMPORT_LIST_SIMD(float, floatList, double)
+IMPORT_LIST(uint64_t, u64List)
+IMPORT_LIST_SIMD(uint64_t, u64List, uint64_t)
+
+#define NEGATIVE(x) ((x) < 0)
+IMPORT_LIST_SIMD_FIND_IF(int, intList, negative, NEGATIVE)
+
+#define ROUNDS 5
+
+static int compare_ints(const void *a, const void *b)
+{
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+static int compare_floats(const void *a, const void *b)
+{
+    float x = *(const float *) a;
+    float y = *(const float *) b;
+    return (x > y) - (x < y);
+}
+
+static int compare_u64s(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name, size_t bytes, double seconds)
+{
+    printf("  %-12s %8.2f GB/s\n", name, bytes * ROUNDS / seconds * 1e-9);
+}
+
+/* Checked so the compiler cannot drop a kernel whose result is unused. */
+static volatile int64_t sink;
+
+static void expect(int ok, const char *kernel)
+{
+    if (ok) return;
+    fprintf(stderr, "%s disagrees with a plain loop\n", kernel);
+    exit(1);
+}
+
+/* Runs each kernel through L's API and as the base kernel, against a loop. */
+#define CHECK_KERNELS(L, T, S, list, x)                                        \
+    do {                                                                       \
+        const T *data = list->data;                                            \
+        ssize_t size = list->size, first = -1, count = 0;                      \
+        T lo = data[0], hi = data[0], got;                                     \
+        S total = 0;                                                           \
+        for (ssize_t i = 0; i < size; i++) {                                   \
+            if (data[i] == (x) && first < 0) first = i;                        \
+            count += data[i] == (x);                                           \
+            if (data[i] < lo) lo = data[i];                                    \
+            if (data[i] > hi) hi = data[i];                                    \
+            total += (S) data[i];                                              \
+        }                                                                      \
+        expect(L##_find_eq(list, x) == first                                   \
+               && L##_find_eq_base(data, size, x) == first, #L "_find_eq");    \
+        expect(L##_count_eq(list, x) == count                                  \
+               && L##_count_eq_base(data, size, x) == count, #L "_count_eq");  \
+        expect(!L##_min(list, &got) && got == lo                               \
+               && L##_min_base(data, size) == lo, #L "_min");                  \
+        expect(!L##_max(list, &got) && got == hi                               \
+               && L##_max_base(data, size) == hi, #L "_max");                  \
+        expect(L##_sum(list) == total && L##_sum_base(data, size) == total,    \
+               #L "_sum");                                                     \
+    } while (0)
+
+/*
+ * Every element is non-negative, so misses scan the whole list. The kernels
+ * are checked on that list, then again with miss planted twice near the end.
+ */
+#define BENCH_LIST(L, T, S, cmp, miss)                                         \
+    do {                                                                       \
+        L list = LNEW(L);                                                      \
+        ssize_t n = (ssize_t) (bytes / sizeof(T));                             \
+        uint64_t seed = 0x9E3779B97F4A7C15ULL;                                 \
+        if (!list) return MEMORY_ALLOCATION_ERR;                               \
+        list->size = n;                                                        \
+        if (list->resize(list)) return MEMORY_ALLOCATION_ERR;                  \
+        for (ssize_t i = 0; i < n; i++)                                        \
+            list->data[i] = (T) (bench_rand(&seed) % 1000000);                 \
+        printf(#T " (%zu MB)\n", bytes >> 20);                                 \
+                                                                               \
+        double start = bench_now();                                            \
+        for (int r = 0; r < ROUNDS; r++) sink += list->find(list, miss, cmp);  \
+        report("find", bytes, bench_now() - start);                            \
+                                                                               \
+        start = bench_now();                                                   \
+        for (int r = 0; r < ROUNDS; r++) sink += L##_find_eq(list, miss);      \
+        report("find_eq", bytes, bench_now() - start);                         \
+                                                                               \
+        start = bench_now();                                                   \
+        for (int r = 0; r < ROUNDS; r++) sink += L##_count_eq(list, miss);     \
+        report("count_eq", bytes, bench_now() - start);                        \
+                                                                               \
+        T value = 0;                                                           \
+        start = bench_now();                                                   \
+        for (int r = 0; r < ROUNDS; r++) {                                     \
+            sink += L##_min(list, &value);                                     \
+            sink += (int64_t) value;                                           \
+        }                                                                      \
+        report("min", bytes, bench_now() - start);                             \
+                                                                               \
+        start = bench_now();                                                   \
+        for (int r = 0; r < ROUNDS; r++) {                                     \
+            sink += L##_max(list, &value);                                     \
+            sink += (int64_t) value;                                           \
+        }                                                                      \
+        report("max", bytes, bench_now() - start);                             \
+                                                                               \
+        start = bench_now();                                                   \
+        for (int r = 0; r < ROUNDS; r++) sink += (int64_t) L##_sum(list);      \
+        report("sum", bytes, bench_now() - start);                             \
+                                                                               \
+        CHECK_KERNELS(L, T, S, list, miss);                                    \
+        list->data[n - n / 3] = list->data[n - 1] = miss;                      \
+        CHECK_KERNELS(L, T, S, list, miss);                                    \
+        list->destroy(list);                                                   \
+    } while (0)
+
+int main(int argc, char **argv)
+{
+    size_t bytes = (size_t) bench_arg(argc, argv, 256L << 20);
+    printf("kernels: %s\n", list_simd_isa());
+
+    BENCH_LIST(intList, int, int64_t, compare_ints, -1);
+    {
+        intList list = LNEW(intList);
+        ssize_t n = (ssize_t) (bytes / sizeof(int));
+        if (!list) return MEMORY_ALLOCATION_ERR;
+        list->size = n;
+        if (list->resize(list)) return MEMORY_ALLOCATION_ERR;
+        memset(list->data, 0, n * sizeof(int));
+        double start = bench_now();
+        for (int r = 0; r < ROUNDS; r++) sink += intList_find_negative(list);
+        report("find_if", bytes, bench_now() - start);
+
+        for (int planted = 0; planted < 2; planted++) {
+            if (planted) list->data[n - n / 3] = list->data[n - 1] = -5;
+            ssize_t first = -1;
+            for (ssize_t i = n - 1; i >= 0; i--)
+                if (NEGATIVE(list->data[i])) first = i;
+            expect(intList_find_negative(list) == first
+                   && intList_find_negative_base(list->data, n) == first,
+                   "intList_find_negative");
+        }
+        list->destroy(list);
+    }
+    BENCH_LIST(floatList, float, double, compare_floats, -1.0f);
+    BENCH_LIST(u64List, uint64_t, uint64_t, compare_u64s, UINT64_MAX);
+    return 0;
+}
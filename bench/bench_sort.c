@@ -0,0 +1,129 @@
+// Compares the list sort engine against the previous recursive quicksort and
+// the C library qsort on random, sorted, reversed and many-duplicate inputs.
+//
+// Usage: bench_sort [elements]
+
+#include "bench.h"
+#include "list.h"
+
+#define INT_LESS(a, b) ((a) < (b))
+
+IMPORT_LIST(int, intList)
+IMPORT_LIST_SORT_BY(int, intList, asc, INT_LESS)
+IMPORT_LIST_RADIX_SORT(int, intList, SIGNED)
+
+typedef enum { RANDOM, SORTED, REVERSED, DUPLICATES, INPUT_COUNT } Input;
+
+static const char *input_names[INPUT_COUNT] = {
+    "random", "sorted", "reversed", "duplicates"
+};
+
+static int compare_ints(const void *a, const void *b)
+{
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+/* The middle-pivot quicksort that L##_sort used to be. */
+static void legacy_sort(int *data, ssize_t left, ssize_t right,
+                        compare_func cmp)
+{
+    if (left >= right) return;
+
+    int pivot = data[left + (right - left) / 2];
+    ssize_t i = left;
+    ssize_t j = right;
+
+    while (i <= j) {
+        while (cmp(&data[i], &pivot) < 0) i++;
+        while (cmp(&data[j], &pivot) > 0) j--;
+
+        if (i <= j) {
+            int tmp = data[i];
+            data[i] = data[j];
+            data[j] = tmp;
+            i++;
+            j--;
+        }
+    }
+    legacy_sort(data, left, j, cmp);
+    legacy_sort(data, i, right, cmp);
+}
+
+static void fill(int *data, ssize_t n, Input input)
+{
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (ssize_t i = 0; i < n; i++) {
+        switch (input) {
+            case RANDOM: data[i] = (int) bench_rand(&seed); break;
+            case SORTED: data[i] = (int) i; break;
+            case REVERSED: data[i] = (int) (n - i); break;
+            default: data[i] = (int) (bench_rand(&seed) % 16); break;
+        }
+    }
+}
+
+static int is_sorted(const int *data, ssize_t n)
+{
+    for (ssize_t i = 1; i < n; i++)
+        if (data[i - 1] > data[i]) return 0;
+    return 1;
+}
+
+static double run(intList list, Input input, int engine)
+{
+    /* Hidden from the optimiser so no engine gets compare_ints inlined. */
+    compare_func volatile opaque = compare_ints;
+    compare_func cmp = opaque;
+    ssize_t n = list->len(list);
+    fill(list->data, n, input);
+
+    double start = bench_now();
+    switch (engine) {
+        case 0: legacy_sort(list->data, 0, n - 1, cmp); break;
+        case 1: qsort(list->data, n, sizeof(int), cmp); break;
+        case 2: list->sort(list, 0, n - 1, cmp); break;
+        case 3: intList_sort_by_asc(list, 0, n - 1); break;
+        default: intList_radix_sort(list, 0, n - 1); break;
+    }
+    double elapsed = bench_now() - start;
+
+    if (!is_sorted(list->data, n)) {
+        fprintf(stderr, "engine %d left %s input unsorted\n",
+                engine, input_names[input]);
+        exit(1);
+    }
+    return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *engines[] = {
+        "legacy", "qsort", "sort", "sort_by", "radix"
+    };
+    ssize_t n = bench_arg(argc, argv, 1L << 22);
+
+    intList list = LNEW(intList);
+    if (!list) return MEMORY_ALLOCATION_ERR;
+    for (ssize_t i = 0; i < n; i++) {
+        if (list->append(list, 0)) {
+            list->destroy(list);
+            return MEMORY_ALLOCATION_ERR;
+        }
+    }
+
+    printf("%-12s", "input");
+    for (int e = 0; e < 5; e++) printf("%12s", engines[e]);
+    printf("   (ms, %ld ints)\n", (long) n);
+
+    for (int input = 0; input < INPUT_COUNT; input++) {
+        printf("%-12s", input_names[input]);
+        for (int e = 0; e < 5; e++)
+            printf("%12.2f", run(list, (Input) input, e) * 1e3);
+        printf("\n");
+    }
+
+    list->destroy(list);
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Windows a large list into per-worker pieces with views and with slice, and
+// reports the time taken and the process's peak memory after each.
+//
+// Usage: bench_view [bytes]
+
+#include <sys/resource.h>
+
+#include "bench.h"
+#include "list.h"
+
+IMPORT_LIST(int64_t, i64List)
+
+#define WINDOWS 64
+
+static long peak_mb(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024;
+}
+
+static int64_t sum_view(view_i64List view)
+{
+    int64_t sum = 0;
+    for (ssize_t i = 0; i < view.len; i++) sum += *i64List_view_at(view, i);
+    return sum;
+}
+
+static int64_t sum_list(i64List list)
+{
+    int64_t sum = 0;
+    for (ssize_t i = 0; i < list->len(list); i++) sum += list->data[i];
+    return sum;
+}
+
+int main(int argc, char **argv)
+{
+    ssize_t n = bench_arg(argc, argv, 1L << 30) / (ssize_t) sizeof(int64_t);
+    i64List list = LNEW(i64List);
+    if (!list || list->reserve(list, n)) return MEMORY_ALLOCATION_ERR;
+    for (ssize_t i = 0; i < n; i++) list->data[i] = i;
+    list->size = n;
+    printf("%ld MB list, %d windows, peak %ld MB\n",
+           (long) (n * sizeof(int64_t) >> 20), WINDOWS, peak_mb());
+
+    /* Views run first, since the peak can only go up. */
+    int64_t sums[2] = {0, 0};
+    ssize_t width = n / WINDOWS;
+    for (int pass = 0; pass < 2; pass++) {
+        ssize_t step = pass ? 4 : 1;
+        double start = bench_now();
+        for (int w = 0; w < WINDOWS; w++) {
+            view_i64List view;
+            if (i64List_view(list, w * width, (w + 1) * width - 1, step, &view))
+                return INDEX_OUT_OF_RANGE;
+            sums[pass] += sum_view(view);
+        }
+        printf("view  step %ld %10.2f ms  held %10zu bytes  peak %6ld MB\n",
+               (long) step, (bench_now() - start) * 1e3,
+               WINDOWS * sizeof(view_i64List), peak_mb());
+    }
+
+    /* Workers hold their windows at the same time, as they would. */
+    for (int pass = 0; pass < 2; pass++) {
+        ssize_t step = pass ? 4 : 1;
+        i64List windows[WINDOWS];
+        size_t held = 0;
+        int64_t sum = 0;
+        double start = bench_now();
+        for (int w = 0; w < WINDOWS; w++) {
+            windows[w] = list->slice(list, w * width, (w + 1) * width - 1, step);
+            if (!windows[w]) return MEMORY_ALLOCATION_ERR;
+            held += windows[w]->cap(windows[w]) * sizeof(int64_t);
+            sum += sum_list(windows[w]);
+        }
+        printf("slice step %ld %10.2f ms  held %10zu bytes  peak %6ld MB\n",
+               (long) step, (bench_now() - start) * 1e3, held, peak_mb());
+        for (int w = 0; w < WINDOWS; w++) windows[w]->destroy(windows[w]);
+
+        if (sum != sums[pass]) {
+            fprintf(stderr, "views and slices disagree\n");
+            return 1;
+        }
+    }
+
+    list->destroy(list);
+    return 0;
+}
@@ -21,14 +21,324 @@ typedef enum {
     MEMORY_ALLOCATION_ERR = 1,
     INDEX_OUT_OF_RANGE = 2,
     UNINITIALISED_ARRAY = 3,
+    FILE_IO_ERR = 4,
+    FILE_FORMAT_ERR = 5,
+    FROZEN_LIST_ERR = 6,
 } ListErrors;
 
+/*
+ * Where a list gets its memory from. Every call is passed ctx, and realloc
+ * and free are also told the size of the block, so allocators do not need
+ * to keep headers. A NULL allocator means malloc, realloc and free.
+ */
+typedef struct ListAllocator {
+    void *(*allocate)(void *ctx, size_t size);
+    void *(*reallocate)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void (*release)(void *ctx, void *ptr, size_t size);
+    void *ctx;
+} ListAllocator;
+
+static inline void *list_alloc(const ListAllocator *allocator, size_t size)
+{
+    if (!allocator) return malloc(size);
+    return allocator->allocate(allocator->ctx, size);
+}
+
+static inline void *list_realloc(const ListAllocator *allocator, void *ptr,
+                                 size_t old_size, size_t new_size)
+{
+    if (!allocator) return realloc(ptr, new_size);
+    return allocator->reallocate(allocator->ctx, ptr, old_size, new_size);
+}
+
+static inline void list_free(const ListAllocator *allocator, void *ptr,
+                             size_t size)
+{
+    if (!allocator) {
+        free(ptr);
+        return;
+    }
+    allocator->release(allocator->ctx, ptr, size);
+}
+
+/*
+ * How a list's capacity follows its length. Capacity is multiplied by factor
+ * when the list fills up. If shrink is set, capacity is divided by factor
+ * once the length drops below capacity / factor^2, which leaves a band in
+ * which pushing and popping never reallocates. Automatic resizing never
+ * goes below min_capacity.
+ */
+typedef struct {
+    double factor;
+    int shrink;
+    ssize_t min_capacity;
+} ListGrowth;
+
+static const ListGrowth list_growth_default = { 2.0, 1, 0 };
+
+/* The capacity a list of `size` elements should have, given its current. */
+static inline ssize_t list_next_capacity(const ListGrowth *growth,
+                                         ssize_t size, ssize_t capacity)
+{
+    double factor = growth->factor > 1.0 ? growth->factor : 2.0;
+    ssize_t new_capacity = capacity;
+
+    if (size >= capacity) {
+        while (new_capacity <= size) {
+            ssize_t next = (ssize_t) ((double) new_capacity * factor);
+            new_capacity = next > new_capacity ? next : new_capacity + 1;
+        }
+    } else if (growth->shrink && (double) size * factor * factor < capacity) {
+        while ((double) size * factor * factor < new_capacity)
+            new_capacity = (ssize_t) ((double) new_capacity / factor);
+        if (new_capacity <= size) new_capacity = size + 1;
+    }
+    if (new_capacity < growth->min_capacity) new_capacity = growth->min_capacity;
+    return new_capacity;
+}
+
+/*
+ * Shuffle's default generator and the sort comparison counter are kept per
+ * thread under C11. A C99 build shares one copy between threads instead.
+ */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define LIST_THREAD_LOCAL _Thread_local
+#else
+#define LIST_THREAD_LOCAL
+#endif
+
+/*
+ * Per-list operation counters, returned by L##_stats. They are only kept
+ * when LIST_STATS is defined; otherwise lists carry no counters and
+ * L##_stats returns zeros. Comparisons cover sort and find.
+ */
+typedef struct {
+    ssize_t reallocs;
+    ssize_t bytes_moved;
+    ssize_t comparisons;
+    ssize_t peak_capacity;
+} ListStats;
+
+#ifdef LIST_STATS
+#define LIST_STATS_FIELD ListStats stats;
+#define LIST_STAT_ADD(list, field, n) ((list)->stats.field += (ssize_t) (n))
+#define LIST_STAT_PEAK(list)                                                   \
+    do {                                                                       \
+        if ((list)->capacity > (list)->stats.peak_capacity)                    \
+            (list)->stats.peak_capacity = (list)->capacity;                    \
+    } while (0)
+#define LIST_STAT_BEGIN_SORT() (list_stat_comparisons = 0)
+#define LIST_STAT_END_SORT(list)                                               \
+    LIST_STAT_ADD(list, comparisons, list_stat_comparisons)
+#define LIST_STATS_COPY(stats, list) ((stats) = (list)->stats)
+/* Counted by LIST_CMP_LESS on the sorting thread, then added to the list. */
+static LIST_THREAD_LOCAL ssize_t list_stat_comparisons;
+#else
+#define LIST_STATS_FIELD
+#define LIST_STAT_ADD(list, field, n) ((void) 0)
+#define LIST_STAT_PEAK(list) ((void) 0)
+#define LIST_STAT_BEGIN_SORT() ((void) 0)
+#define LIST_STAT_END_SORT(list) ((void) 0)
+#define LIST_STATS_COPY(stats, list) ((void) 0)
+#endif
+
+/* A xorshift64* generator, for shuffles that can be repeated. */
+typedef struct {
+    uint64_t state;
+} ListRng;
+
+static inline void list_rng_seed(ListRng *rng, uint64_t seed)
+{
+    rng->state = seed ? seed : 0x9E3779B97F4A7C15ULL;
+}
+
+static inline uint64_t list_rng_next(ListRng *rng)
+{
+    uint64_t x = rng->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng->state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/* A number in [0, bound), unbiased enough for shuffling. */
+static inline uint64_t list_rng_below(ListRng *rng, uint64_t bound)
+{
+    uint64_t x = list_rng_next(rng);
+    if (bound <= UINT32_MAX) return ((x >> 32) * bound) >> 32;
+    return x % bound;
+}
+
+/* The generator behind shuffle, seeded once per thread. */
+static inline ListRng *list_rng_default(void)
+{
+    static LIST_THREAD_LOCAL ListRng rng;
+    if (!rng.state)
+        list_rng_seed(&rng, (uint64_t) time(NULL) ^ (uint64_t) (uintptr_t) &rng);
+    return &rng;
+}
+
+/* Partitions at or below this length are finished with insertion sort. */
+#define LIST_SORT_CUTOFF 16
+/* Partitions above this length pick their pivot with Tukey's ninther. */
+#define LIST_NINTHER_CUTOFF 128
+
+/* Introsort falls back to heapsort once it recurses 2*log2(n) deep. */
+static inline int list_sort_depth(ssize_t n)
+{
+    int depth = 0;
+    while (n > 1) {
+        depth++;
+        n >>= 1;
+    }
+    return depth * 2;
+}
+
+/* Maps an IEEE float/double bit pattern onto an unsigned radix key. */
+static inline uint64_t list_radix_float_key(const void *x, size_t size)
+{
+    if (size == sizeof(uint32_t)) {
+        uint32_t u;
+        memcpy(&u, x, sizeof(u));
+        return (u >> 31) ? (uint32_t) ~u : (u | 0x80000000u);
+    }
+    uint64_t u;
+    memcpy(&u, x, sizeof(u));
+    return (u >> 63) ? ~u : (u | ((uint64_t) 1 << 63));
+}
+
+#define LIST_RADIX_MASK(T) (~(uint64_t) 0 >> (64 - 8 * sizeof(T)))
+#define LIST_RADIX_KEY_UNSIGNED(T, x) ((uint64_t) (x))
+#define LIST_RADIX_KEY_SIGNED(T, x)                                            \
+    (((uint64_t) (int64_t) (x) & LIST_RADIX_MASK(T))                           \
+     ^ ((uint64_t) 1 << (8 * sizeof(T) - 1)))
+#define LIST_RADIX_KEY_FLOAT(T, x) list_radix_float_key(&(x), sizeof(T))
+
+/* Orders two elements through the compare_func `cmp` in scope. */
+#ifdef LIST_STATS
+#define LIST_CMP_LESS(a, b) (list_stat_comparisons++, cmp(&(a), &(b)) < 0)
+#else
+#define LIST_CMP_LESS(a, b) (cmp(&(a), &(b)) < 0)
+#endif
+
+/*
+ * Generates an introsort over a raw T array, prefixed with P. LESS(a, b) is
+ * an expression that is true when element a sorts before element b; it may
+ * refer to `cmp`, which is threaded through every helper.
+ */
+#define LIST_SORT_TEMPLATE(T, P, LESS)                                         \
+static void P##_isort(T *a, ssize_t n, compare_func cmp)                       \
+{                                                                              \
+    (void) cmp;                                                                \
+    for (ssize_t i = 1; i < n; i++) {                                          \
+        T tmp = a[i];                                                          \
+        ssize_t j = i;                                                         \
+        while (j > 0 && LESS(tmp, a[j - 1])) {                                 \
+            a[j] = a[j - 1];                                                   \
+            j--;                                                               \
+        }                                                                      \
+        a[j] = tmp;                                                            \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static void P##_sift(T *a, ssize_t root, ssize_t n, compare_func cmp)          \
+{                                                                              \
+    (void) cmp;                                                                \
+    T tmp = a[root];                                                           \
+    ssize_t child;                                                             \
+    while ((child = 2 * root + 1) < n) {                                       \
+        if (child + 1 < n && LESS(a[child], a[child + 1])) child++;            \
+        if (!LESS(tmp, a[child])) break;                                       \
+        a[root] = a[child];                                                    \
+        root = child;                                                          \
+    }                                                                          \
+    a[root] = tmp;                                                             \
+}                                                                              \
+                                                                               \
+static void P##_heapsort(T *a, ssize_t n, compare_func cmp)                    \
+{                                                                              \
+    for (ssize_t i = n / 2 - 1; i >= 0; i--) P##_sift(a, i, n, cmp);           \
+    for (ssize_t i = n - 1; i > 0; i--) {                                      \
+        T tmp = a[0];                                                          \
+        a[0] = a[i];                                                           \
+        a[i] = tmp;                                                            \
+        P##_sift(a, 0, i, cmp);                                                \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static ssize_t P##_median3(T *a, ssize_t i, ssize_t j, ssize_t k,              \
+                           compare_func cmp)                                   \
+{                                                                              \
+    (void) cmp;                                                                \
+    if (LESS(a[i], a[j])) {                                                    \
+        if (LESS(a[j], a[k])) return j;                                        \
+        return LESS(a[i], a[k]) ? k : i;                                       \
+    }                                                                          \
+    if (LESS(a[k], a[j])) return j;                                            \
+    return LESS(a[k], a[i]) ? k : i;                                           \
+}                                                                              \
+                                                                               \
+static void P##_introsort(T *a, ssize_t n, int depth, compare_func cmp)        \
+{                                                                              \
+    (void) cmp;                                                                \
+    while (n > LIST_SORT_CUTOFF) {                                             \
+        if (depth-- == 0) {                                                    \
+            P##_heapsort(a, n, cmp);                                           \
+            return;                                                            \
+        }                                                                      \
+        ssize_t mid = (n - 1) / 2;                                             \
+        ssize_t m;                                                             \
+        if (n > LIST_NINTHER_CUTOFF) {                                         \
+            ssize_t s = n / 8;                                                 \
+            m = P##_median3(a,                                                 \
+                    P##_median3(a, 0, s, 2 * s, cmp),                          \
+                    P##_median3(a, mid - s, mid, mid + s, cmp),                \
+                    P##_median3(a, n - 1 - 2 * s, n - 1 - s, n - 1, cmp),      \
+                    cmp);                                                      \
+        } else {                                                               \
+            m = P##_median3(a, 0, mid, n - 1, cmp);                            \
+        }                                                                      \
+        /* Hoare partition needs the pivot at the lower middle. */             \
+        T pivot = a[m];                                                        \
+        a[m] = a[mid];                                                         \
+        a[mid] = pivot;                                                        \
+                                                                               \
+        ssize_t i = -1;                                                        \
+        ssize_t j = n;                                                         \
+        for (;;) {                                                             \
+            do i++; while (LESS(a[i], pivot));                                 \
+            do j--; while (LESS(pivot, a[j]));                                 \
+            if (i >= j) break;                                                 \
+            T tmp = a[i];                                                      \
+            a[i] = a[j];                                                       \
+            a[j] = tmp;                                                        \
+        }                                                                      \
+                                                                               \
+        /* Recurse into the smaller side, loop on the larger. */               \
+        if (j + 1 < n - j - 1) {                                               \
+            P##_introsort(a, j + 1, depth, cmp);                               \
+            a += j + 1;                                                        \
+            n -= j + 1;                                                        \
+        } else {                                                               \
+            P##_introsort(a + j + 1, n - j - 1, depth, cmp);                   \
+            n = j + 1;                                                         \
+        }                                                                      \
+    }                                                                          \
+    P##_isort(a, n, cmp);                                                      \
+}
+
 #define IMPORT_LIST(T, L)                                                      \
 typedef struct _##L                                                            \
 {                                                                              \
     ssize_t size;                                                              \
     ssize_t capacity;                                                          \
     T *data;                                                                   \
+    const ListAllocator *allocator;                                            \
+    ListGrowth growth;                                                         \
+    /* Set by reserve: automatic shrinking keeps at least this capacity. */    \
+    ssize_t reserved;                                                          \
+    LIST_STATS_FIELD                                                           \
                                                                                \
     int (*get)(struct _##L*, ssize_t, T*);                                     \
     int (*set)(struct _##L*, ssize_t, T);                                      \
@@ -46,10 +356,26 @@ typedef struct _##L                                                            \
     void (*clear)(struct _##L*);                                               \
     void (*destroy)(struct _##L*);                                             \
     int (*resize)(struct _##L*);                                               \
+    int (*reserve)(struct _##L*, ssize_t);                                     \
+    int (*shrink_to_fit)(struct _##L*);                                        \
+    int (*append_n)(struct _##L*, const T*, ssize_t);                          \
+    int (*extend)(struct _##L*, struct _##L*);                                 \
+    int (*insert_range)(struct _##L*, ssize_t, const T*, ssize_t);             \
+    int (*erase_range)(struct _##L*, ssize_t, ssize_t);                        \
+    int (*remove_if)(struct _##L*, int (const T*, void*), void*);              \
 } _##L;                                                                        \
                                                                                \
 typedef _##L *L;                                                               \
 typedef int (*foreach_func_##L)(L, ssize_t);                                   \
+typedef int (*predicate_func_##L)(const T*, void*);                            \
+                                                                               \
+/* A non-owning window onto a list: len elements, stride elements apart. */    \
+typedef struct {                                                               \
+    T *base;                                                                   \
+    ssize_t len;                                                               \
+    ssize_t stride;                                                            \
+} view_##L;                                                                    \
+typedef int (*view_func_##L)(view_##L, ssize_t);                               \
                                                                                \
 static int L##_resize(L list);                                                 \
 static int L##_get(L list, ssize_t index, T* result);                          \
@@ -64,9 +390,23 @@ static ssize_t L##_find(L list, T element, compare_func cmp);                  \
 static int L##_foreach(L list, foreach_func_##L func);                         \
 static L L##_slice(L list, ssize_t left, ssize_t right, ssize_t step);         \
 static int L##_shuffle(L list, ssize_t left, ssize_t right);                   \
+static int L##_shuffle_with(L list, ssize_t left, ssize_t right,               \
+                           ListRng *rng);                                      \
 static void L##_reverse(L list);                                               \
 static void L##_clear(L list);                                                 \
 static void L##_destroy(L list);                                               \
+static int L##_reserve(L list, ssize_t capacity);                              \
+static int L##_shrink_to_fit(L list);                                          \
+static int L##_append_n(L list, const T *elements, ssize_t count);             \
+static int L##_extend(L list, L other);                                        \
+static int L##_insert_range(L list, ssize_t index, const T *elements,          \
+                            ssize_t count);                                    \
+static int L##_erase_range(L list, ssize_t left, ssize_t right);               \
+static int L##_remove_if(L list, predicate_func_##L pred, void *ctx);          \
+static int L##_make_room(L list, ssize_t needed);                              \
+static int L##_set_capacity(L list, ssize_t capacity);                         \
+                                                                               \
+LIST_SORT_TEMPLATE(T, L##_cmp, LIST_CMP_LESS)                                  \
                                                                                \
 static ssize_t L##_size(L list)                                                \
 {                                                                              \
@@ -78,13 +418,41 @@ static ssize_t L##_capacity(L list)                                            \
     return list->capacity;                                                     \
 }                                                                              \
                                                                                \
-static L L##_new()                                                             \
+static inline ListStats L##_stats(L list)                                      \
+{                                                                              \
+    ListStats stats = { 0, 0, 0, 0 };                                          \
+    (void) list;                                                               \
+    LIST_STATS_COPY(stats, list);                                              \
+    return stats;                                                              \
+}                                                                              \
+                                                                               \
+/* Inlinable append: a plain store unless the list is full. */                 \
+static inline int L##_push(L list, T element)                                  \
 {                                                                              \
-    L result = (L)calloc(1, sizeof(_##L));                                     \
+    if (list->size < list->capacity) {                                         \
+        list->data[list->size++] = element;                                    \
+        return 0;                                                              \
+    }                                                                          \
+    return L##_append(list, element);                                          \
+}                                                                              \
+                                                                               \
+/* Unchecked access, for iterating over 0 <= index < list->size. */            \
+static inline T L##_at(L list, ssize_t index)                                  \
+{                                                                              \
+    return list->data[index];                                                  \
+}                                                                              \
+                                                                               \
+/* The allocator must outlive the list; NULL uses malloc. */                   \
+static L L##_new_with(const ListAllocator *allocator)                          \
+{                                                                              \
+    L result = (L)list_alloc(allocator, sizeof(_##L));                         \
     if (result) {                                                              \
+        memset(result, 0, sizeof(_##L));                                       \
         result->data = NULL;                                                   \
         result->capacity = 0;                                                  \
         result->size = 0;                                                      \
+        result->allocator = allocator;                                         \
+        result->growth = list_growth_default;                                  \
                                                                                \
         /* Function APIs */                                                    \
         result->get = L##_get; result->set = L##_set;                          \
@@ -95,14 +463,25 @@ static L L##_new()                                                             \
         result->foreach = L##_foreach; result->find = L##_find;                \
         result->shuffle = L##_shuffle; result->resize = L##_resize;            \
         result->reverse = L##_reverse; result->slice = L##_slice;              \
+        result->reserve = L##_reserve;                                         \
+        result->shrink_to_fit = L##_shrink_to_fit;                             \
+        result->append_n = L##_append_n; result->extend = L##_extend;          \
+        result->insert_range = L##_insert_range;                               \
+        result->erase_range = L##_erase_range;                                 \
+        result->remove_if = L##_remove_if;                                     \
     }                                                                          \
     return result;                                                             \
 }                                                                              \
                                                                                \
+static inline L L##_new()                                                      \
+{                                                                              \
+    return L##_new_with(NULL);                                                 \
+}                                                                              \
+                                                                               \
 static int L##_get(L list, ssize_t index, T* result)                           \
 {                                                                              \
     if (!list) return UNINITIALISED_ARRAY;                                     \
-    if (list->len(list) <= index) return INDEX_OUT_OF_RANGE;                   \
+    if (list->size <= index) return INDEX_OUT_OF_RANGE;                        \
     *result = list->data[index];                                               \
                                                                                \
     return 0;                                                                  \
@@ -111,7 +490,7 @@ static int L##_get(L list, ssize_t index, T* result)                           \
 static int L##_set(L list, ssize_t index, T element)                           \
 {                                                                              \
     if (!list) return UNINITIALISED_ARRAY;                                     \
-    if (list->len(list) <= index) return INDEX_OUT_OF_RANGE;                   \
+    if (list->size <= index) return INDEX_OUT_OF_RANGE;                        \
     list->data[index] = element;                                               \
     return 0;                                                                  \
 }                                                                              \
@@ -119,7 +498,7 @@ static int L##_set(L list, ssize_t index, T element)                           \
 static int L##_append(L list, T element)                                       \
 {                                                                              \
     int retCode;                                                               \
-    if ((retCode = list->resize(list))) return retCode;                        \
+    if ((retCode = L##_make_room(list, list->size + 1))) return retCode;       \
     list->data[list->size++] = element;                                        \
     return retCode;                                                            \
 }                                                                              \
@@ -132,28 +511,25 @@ static int L##_pop(L list, ssize_t index, T *result)                           \
     *result = list->data[index];                                               \
     memmove(&list->data[index], &list->data[index + 1],                        \
             (--(list->size) - index) * sizeof(T));                             \
-    int retCode;                                                               \
-    if ((retCode = list->resize(list))) return retCode;                        \
-    return retCode;                                                            \
+    LIST_STAT_ADD(list, bytes_moved, (list->size - index) * sizeof(T));        \
+    return L##_resize(list);                                                   \
 }                                                                              \
                                                                                \
 static int L##_insert(L list, ssize_t index, T element)                        \
 {                                                                              \
     int retCode = 0;                                                           \
-    if (!index && !list->len(list)) {                                          \
-        retCode = list->append(list, element);                                 \
+    if (!index && !list->size) {                                               \
+        retCode = L##_append(list, element);                                   \
         return retCode;                                                        \
     }                                                                          \
-    if (index >= list->len(list)) {                                            \
+    if (index >= list->size) {                                                 \
         return INDEX_OUT_OF_RANGE;                                             \
     }                                                                          \
+    if ((retCode = L##_make_room(list, list->size + 1))) return retCode;       \
     list->size++;                                                              \
-    if ((retCode = list->resize(list))) {                                      \
-        list->size--;                                                          \
-        return retCode;                                                        \
-    }                                                                          \
     memmove(&list->data[index + 1], &list->data[index],                        \
-            (list->len(list) - index) * sizeof(T));                            \
+            (list->size - index - 1) * sizeof(T));                             \
+    LIST_STAT_ADD(list, bytes_moved, (list->size - index - 1) * sizeof(T));    \
     list->data[index] = element;                                               \
     return retCode;                                                            \
 }                                                                              \
@@ -161,41 +537,29 @@ static int L##_insert(L list, ssize_t index, T element)                        \
 static void L##_clear(L list)                                                  \
 {                                                                              \
     if (!list->data) return;                                                   \
-    free(list->data);                                                          \
+    list_free(list->allocator, list->data, list->capacity * sizeof(T));        \
     list->size = 0;                                                            \
     list->data = NULL;                                                         \
     list->capacity = 0;                                                        \
+    list->reserved = 0;                                                        \
 }                                                                              \
                                                                                \
 static void L##_destroy(L list)                                                \
 {                                                                              \
     if (!list) return;                                                         \
-    list->clear(list);                                                         \
-    free(list);                                                                \
+    L##_clear(list);                                                           \
+    list_free(list->allocator, list, sizeof(_##L));                            \
 }                                                                              \
                                                                                \
 static void L##_sort(L list, ssize_t left, ssize_t right, compare_func cmp)    \
 {                                                                              \
+    if (!list || !cmp || left < 0 || right >= list->size) return;              \
     if (left >= right) return;                                                 \
                                                                                \
-    T pivot = list->data[left + (right - left) / 2];                           \
-    ssize_t i = left;                                                          \
-    ssize_t j = right;                                                         \
-                                                                               \
-    while (i <= j) {                                                           \
-        while (cmp(&list->data[i], &pivot) < 0) i++;                           \
-        while (cmp(&list->data[j], &pivot) > 0) j--;                           \
-                                                                               \
-        if (i <= j) {                                                          \
-            T tmp = list->data[i];                                             \
-            list->data[i] = list->data[j];                                     \
-            list->data[j] = tmp;                                               \
-            i++;                                                               \
-            j--;                                                               \
-        }                                                                      \
-    }                                                                          \
-    L##_sort(list, left, j, cmp);                                              \
-    L##_sort(list, i, right, cmp);                                             \
+    ssize_t n = right - left + 1;                                              \
+    LIST_STAT_BEGIN_SORT();                                                    \
+    L##_cmp_introsort(&list->data[left], n, list_sort_depth(n), cmp);          \
+    LIST_STAT_END_SORT(list);                                                  \
 }                                                                              \
                                                                                \
 static int L##_foreach(L list, foreach_func_##L func)                          \
@@ -203,7 +567,7 @@ static int L##_foreach(L list, foreach_func_##L func)                          \
     if (!list || !list->data || !func) return UNINITIALISED_ARRAY;             \
                                                                                \
     int retCode = 0;                                                           \
-    for (ssize_t i = 0; i < list->len(list); i++) {                            \
+    for (ssize_t i = 0; i < list->size; i++) {                                 \
         retCode = func(list, i);                                               \
         if (retCode) return retCode;                                           \
     }                                                                          \
@@ -212,23 +576,33 @@ static int L##_foreach(L list, foreach_func_##L func)                          \
                                                                                \
 static ssize_t L##_find(L list, T element, compare_func cmp)                   \
 {                                                                              \
-    for (ssize_t i = 0; i < list->len(list); i++) {                            \
-        if (cmp(&list->data[i], &element) == 0) return i;                      \
+    ssize_t n = list->size;                                                    \
+    for (ssize_t i = 0; i < n; i++) {                                          \
+        if (cmp(&list->data[i], &element) == 0) {                              \
+            LIST_STAT_ADD(list, comparisons, i + 1);                           \
+            return i;                                                          \
+        }                                                                      \
     }                                                                          \
+    LIST_STAT_ADD(list, comparisons, n);                                       \
     return -1;                                                                 \
 }                                                                              \
                                                                                \
 static int L##_shuffle(L list, ssize_t left, ssize_t right)                    \
+{                                                                              \
+    return L##_shuffle_with(list, left, right, list_rng_default());            \
+}                                                                              \
+                                                                               \
+/* Shuffles [left, right] with the caller's generator, so runs can repeat. */  \
+static int L##_shuffle_with(L list, ssize_t left, ssize_t right, ListRng *rng) \
 {                                                                              \
     if (list->size <= 1) return 0;                                             \
                                                                                \
-    if (right <= left || left < 0 || right >= list->len(list))                 \
+    if (right <= left || left < 0 || right >= list->size)                      \
         return INDEX_OUT_OF_RANGE;                                             \
                                                                                \
-    srand((unsigned int) time(NULL));                                          \
-                                                                               \
     for (ssize_t i = right; i > left; i--) {                                   \
-        ssize_t j = rand() % (i + 1);                                          \
+        uint64_t span = (uint64_t) (i - left + 1);                             \
+        ssize_t j = left + (ssize_t) list_rng_below(rng, span);                \
                                                                                \
         T tmp = list->data[i];                                                 \
         list->data[i] = list->data[j];                                         \
@@ -239,53 +613,433 @@ static int L##_shuffle(L list, ssize_t left, ssize_t right)                    \
                                                                                \
 static void L##_reverse(L list)                                                \
 {                                                                              \
-    for (ssize_t i = 0; i < list->len(list) / 2; i++) {                        \
-        T tmp = list->data[i];                                                 \
-        list->data[i] = list->data[list->len(list) - i - 1];                   \
-        list->data[list->len(list) - i - 1] = tmp;                             \
+    T *data = list->data;                                                      \
+    ssize_t n = list->size;                                                    \
+    for (ssize_t i = 0; i < n / 2; i++) {                                      \
+        T tmp = data[i];                                                       \
+        data[i] = data[n - i - 1];                                             \
+        data[n - i - 1] = tmp;                                                 \
     }                                                                          \
 }                                                                              \
                                                                                \
 static L L##_slice(L list, ssize_t left, ssize_t right, ssize_t step)          \
 {                                                                              \
-    if (left < 0 || right >= list->len(list) || left > right)                  \
+    if (left < 0 || right >= list->size || left > right)                       \
         return NULL;                                                           \
     if (step < 1) return NULL;                                                 \
-    L new_list = L##_new();                                                    \
+    L new_list = L##_new_with(list->allocator);                                \
+    if (!new_list) return NULL;                                                \
+                                                                               \
+    ssize_t count = (right - left) / step + 1;                                 \
+    if (L##_set_capacity(new_list, count)) {                                   \
+        L##_destroy(new_list);                                                 \
+        return NULL;                                                           \
+    }                                                                          \
     if (step == 1) {                                                           \
-        new_list->size = (right - left + 1) / step;                            \
-        new_list->resize(new_list);                                            \
-        memmove(new_list->data, &list->data[left],                             \
-            (right - left + 1) * sizeof(T));                                   \
+        memcpy(new_list->data, &list->data[left], count * sizeof(T));          \
     } else {                                                                   \
-        for (ssize_t i = left; i <= right; i += step)                          \
-            if(new_list->append(new_list, list->data[i])) return NULL;         \
+        for (ssize_t i = 0; i < count; i++)                                    \
+            new_list->data[i] = list->data[left + i * step];                   \
     }                                                                          \
+    new_list->size = count;                                                    \
     return new_list;                                                           \
 }                                                                              \
                                                                                \
-static int L##_resize(L list)                                                  \
+/* Moves the data to a buffer of exactly `capacity` elements. */               \
+static int L##_set_capacity(L list, ssize_t capacity)                          \
 {                                                                              \
-    ssize_t new_capacity = list->capacity;                                     \
-    if (list->size >= list->capacity) {                                        \
-        while (new_capacity <= list->len(list)) {                              \
-            new_capacity = new_capacity ? new_capacity * 2 : 1;                \
-        }                                                                      \
-    } else if (list->len(list) < list->capacity / 4) {                         \
-        while (new_capacity > (list->size * 4)) {                              \
-            new_capacity /= 2;                                                 \
-        }                                                                      \
+    if (capacity == list->capacity) return 0;                                  \
+    if (capacity == 0) {                                                       \
+        list_free(list->allocator, list->data, list->capacity * sizeof(T));    \
+        list->data = NULL;                                                     \
+        list->capacity = 0;                                                    \
+        return 0;                                                              \
     }                                                                          \
-    T *new_data = (T *) realloc(list->data, new_capacity * sizeof(T));         \
+    T *new_data = (T *) list_realloc(list->allocator, list->data,              \
+                                     list->capacity * sizeof(T),               \
+                                     capacity * sizeof(T));                    \
     if (new_data) {                                                            \
         list->data = new_data;                                                 \
-        list->capacity = new_capacity;                                         \
+        list->capacity = capacity;                                             \
+        LIST_STAT_ADD(list, reallocs, 1);                                      \
+        LIST_STAT_PEAK(list);                                                  \
         return 0;                                                              \
     }                                                                          \
     return MEMORY_ALLOCATION_ERR;                                              \
 }                                                                              \
                                                                                \
+static int L##_resize(L list)                                                  \
+{                                                                              \
+    ssize_t capacity = list_next_capacity(&list->growth, list->size,           \
+                                          list->capacity);                     \
+    if (capacity < list->reserved) capacity = list->reserved;                  \
+    return L##_set_capacity(list, capacity);                                   \
+}                                                                              \
+                                                                               \
+/*                                                                             \
+ * Makes room for at least `capacity` elements without further allocation.     \
+ * Popping and erasing will not shrink the list below it again until           \
+ * shrink_to_fit or clear.                                                     \
+ */                                                                            \
+static int L##_reserve(L list, ssize_t capacity)                               \
+{                                                                              \
+    if (!list) return UNINITIALISED_ARRAY;                                     \
+    if (capacity > list->capacity) {                                           \
+        int retCode = L##_set_capacity(list, capacity);                        \
+        if (retCode) return retCode;                                           \
+    }                                                                          \
+    if (capacity > list->reserved) list->reserved = capacity;                  \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+static int L##_shrink_to_fit(L list)                                           \
+{                                                                              \
+    if (!list) return UNINITIALISED_ARRAY;                                     \
+    list->reserved = 0;                                                        \
+    return L##_set_capacity(list, list->size);                                 \
+}                                                                              \
+                                                                               \
+/* Grows, following the growth policy, so that `needed` elements fit. */       \
+static int L##_make_room(L list, ssize_t needed)                               \
+{                                                                              \
+    if (needed <= list->capacity) return 0;                                    \
+    return L##_set_capacity(list, list_next_capacity(&list->growth,            \
+                                                     needed - 1,               \
+                                                     list->capacity));         \
+}                                                                              \
+                                                                               \
+static int L##_append_n(L list, const T *elements, ssize_t count)              \
+{                                                                              \
+    if (!list) return UNINITIALISED_ARRAY;                                     \
+    if (count < 0) return INDEX_OUT_OF_RANGE;                                  \
+    if (!count) return 0;                                                      \
+                                                                               \
+    /* elements may point into this list, which make_room can move. */         \
+    ssize_t offset = -1;                                                       \
+    if (list->data && elements >= list->data                                   \
+        && elements < list->data + list->size)                                 \
+        offset = elements - list->data;                                        \
+    int retCode;                                                               \
+    if ((retCode = L##_make_room(list, list->size + count))) return retCode;   \
+    if (offset >= 0) elements = list->data + offset;                           \
+                                                                               \
+    memcpy(&list->data[list->size], elements, count * sizeof(T));              \
+    list->size += count;                                                       \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+static int L##_extend(L list, L other)                                         \
+{                                                                              \
+    if (!list || !other) return UNINITIALISED_ARRAY;                           \
+    return L##_append_n(list, other->data, other->size);                       \
+}                                                                              \
+                                                                               \
+/* Inserts count elements before index; index may equal the length. */         \
+static int L##_insert_range(L list, ssize_t index, const T *elements,          \
+                            ssize_t count)                                     \
+{                                                                              \
+    if (!list) return UNINITIALISED_ARRAY;                                     \
+    if (index < 0 || index > list->size || count < 0)                          \
+        return INDEX_OUT_OF_RANGE;                                             \
+    if (!count) return 0;                                                      \
+                                                                               \
+    /* Copy out elements that alias this list before they are moved. */        \
+    T *copy = NULL;                                                            \
+    if (list->data && elements < list->data + list->size                       \
+        && elements + count > list->data) {                                    \
+        copy = (T *) list_alloc(list->allocator, count * sizeof(T));           \
+        if (!copy) return MEMORY_ALLOCATION_ERR;                               \
+        memcpy(copy, elements, count * sizeof(T));                             \
+        elements = copy;                                                       \
+    }                                                                          \
+                                                                               \
+    int retCode = L##_make_room(list, list->size + count);                     \
+    if (!retCode) {                                                            \
+        memmove(&list->data[index + count], &list->data[index],                \
+                (list->size - index) * sizeof(T));                             \
+        LIST_STAT_ADD(list, bytes_moved, (list->size - index) * sizeof(T));    \
+        memcpy(&list->data[index], elements, count * sizeof(T));               \
+        list->size += count;                                                   \
+    }                                                                          \
+    if (copy) list_free(list->allocator, copy, count * sizeof(T));             \
+    return retCode;                                                            \
+}                                                                              \
+                                                                               \
+/* Removes [left, right], both endpoints inclusive. */                         \
+static int L##_erase_range(L list, ssize_t left, ssize_t right)                \
+{                                                                              \
+    if (!list) return UNINITIALISED_ARRAY;                                     \
+    if (left < 0 || right >= list->size || left > right)                       \
+        return INDEX_OUT_OF_RANGE;                                             \
+                                                                               \
+    memmove(&list->data[left], &list->data[right + 1],                         \
+            (list->size - right - 1) * sizeof(T));                             \
+    LIST_STAT_ADD(list, bytes_moved, (list->size - right - 1) * sizeof(T));    \
+    list->size -= right - left + 1;                                            \
+    return L##_resize(list);                                                   \
+}                                                                              \
+                                                                               \
+/* Removes the elements pred(&element, ctx) accepts, keeping the order. */     \
+static int L##_remove_if(L list, predicate_func_##L pred, void *ctx)           \
+{                                                                              \
+    if (!list || !pred) return UNINITIALISED_ARRAY;                            \
+    if (!list->size) return 0;                                                 \
+                                                                               \
+    ssize_t kept = 0;                                                          \
+    for (ssize_t i = 0; i < list->size; i++) {                                 \
+        if (pred(&list->data[i], ctx)) continue;                               \
+        if (kept != i) list->data[kept] = list->data[i];                       \
+        kept++;                                                                \
+    }                                                                          \
+    if (kept == list->size) return 0;                                          \
+    list->size = kept;                                                         \
+    return L##_resize(list);                                                   \
+}                                                                              \
+                                                                               \
+/*                                                                             \
+ * Views the same elements slice would copy. The view is invalidated by        \
+ * anything that reallocates the list, as with pointers into data.             \
+ */                                                                            \
+static inline int L##_view(L list, ssize_t left, ssize_t right,                \
+                           ssize_t step, view_##L *result)                     \
+{                                                                              \
+    if (!list) return UNINITIALISED_ARRAY;                                     \
+    if (left < 0 || right >= list->size || left > right || step < 1)           \
+        return INDEX_OUT_OF_RANGE;                                             \
+    result->base = &list->data[left];                                          \
+    result->len = (right - left) / step + 1;                                   \
+    result->stride = step;                                                     \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+/* A view of part of a view, with indices relative to it. */                   \
+static inline int L##_view_slice(view_##L view, ssize_t left, ssize_t right,   \
+                                 ssize_t step, view_##L *result)               \
+{                                                                              \
+    if (left < 0 || right >= view.len || left > right || step < 1)             \
+        return INDEX_OUT_OF_RANGE;                                             \
+    result->base = view.base + left * view.stride;                             \
+    result->len = (right - left) / step + 1;                                   \
+    result->stride = view.stride * step;                                       \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+/* Unchecked access, for iterating over 0 <= index < view.len. */              \
+static inline T *L##_view_at(view_##L view, ssize_t index)                     \
+{                                                                              \
+    return view.base + index * view.stride;                                    \
+}                                                                              \
+                                                                               \
+static inline int L##_view_get(view_##L view, ssize_t index, T *result)        \
+{                                                                              \
+    if (index < 0 || index >= view.len) return INDEX_OUT_OF_RANGE;             \
+    *result = view.base[index * view.stride];                                  \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+static inline ssize_t L##_view_find(view_##L view, T element,                  \
+                                    compare_func cmp)                          \
+{                                                                              \
+    const T *item = view.base;                                                 \
+    for (ssize_t i = 0; i < view.len; i++, item += view.stride) {              \
+        if (cmp(item, &element) == 0) return i;                                \
+    }                                                                          \
+    return -1;                                                                 \
+}                                                                              \
+                                                                               \
+static inline int L##_view_foreach(view_##L view, view_func_##L func)          \
+{                                                                              \
+    if (!view.base || !func) return UNINITIALISED_ARRAY;                       \
+                                                                               \
+    int retCode = 0;                                                           \
+    for (ssize_t i = 0; i < view.len; i++) {                                   \
+        retCode = func(view, i);                                               \
+        if (retCode) return retCode;                                           \
+    }                                                                          \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
 
 #define LNEW(L) L##_new()
 
+/*
+ * Generates L##_sort_by_##NAME(list, left, right), an introsort whose
+ * comparison LESS(a, b) is expanded inline rather than called through a
+ * compare_func. Both endpoints are inclusive, as with sort.
+ */
+#define IMPORT_LIST_SORT_BY(T, L, NAME, LESS)                                  \
+LIST_SORT_TEMPLATE(T, L##_by_##NAME, LESS)                                     \
+                                                                               \
+static inline void L##_sort_by_##NAME(L list, ssize_t left, ssize_t right)     \
+{                                                                              \
+    if (!list || left < 0 || right >= list->size) return;                      \
+    if (left >= right) return;                                                 \
+                                                                               \
+    ssize_t n = right - left + 1;                                              \
+    L##_by_##NAME##_introsort(&list->data[left], n, list_sort_depth(n), NULL); \
+}
+
+/*
+ * Generates L##_radix_sort(list, left, right), an LSD radix sort for
+ * arithmetic T. KIND is one of UNSIGNED, SIGNED or FLOAT and selects how an
+ * element maps onto an unsigned key. Byte passes in which every element
+ * shares the same digit are skipped.
+ */
+#define IMPORT_LIST_RADIX_SORT(T, L, KIND)                                     \
+static inline uint64_t L##_radix_key(T x)                                      \
+{                                                                              \
+    return LIST_RADIX_KEY_##KIND(T, x);                                        \
+}                                                                              \
+                                                                               \
+static inline int L##_radix_sort(L list, ssize_t left, ssize_t right)          \
+{                                                                              \
+    if (!list) return UNINITIALISED_ARRAY;                                     \
+    if (left < 0 || right >= list->size) return INDEX_OUT_OF_RANGE;            \
+    if (left >= right) return 0;                                               \
+                                                                               \
+    ssize_t n = right - left + 1;                                              \
+    ssize_t counts[sizeof(T)][256];                                            \
+    T *src = &list->data[left];                                                \
+    T *tmp = (T *) malloc(n * sizeof(T));                                      \
+    if (!tmp) return MEMORY_ALLOCATION_ERR;                                    \
+                                                                               \
+    memset(counts, 0, sizeof(counts));                                         \
+    for (ssize_t i = 0; i < n; i++) {                                          \
+        uint64_t key = L##_radix_key(src[i]);                                  \
+        for (size_t b = 0; b < sizeof(T); b++)                                 \
+            counts[b][(key >> (8 * b)) & 0xff]++;                              \
+    }                                                                          \
+                                                                               \
+    T *from = src;                                                             \
+    T *to = tmp;                                                               \
+    for (size_t b = 0; b < sizeof(T); b++) {                                   \
+        ssize_t *count = counts[b];                                            \
+        unsigned shift = (unsigned) (8 * b);                                   \
+        if (count[(L##_radix_key(from[0]) >> shift) & 0xff] == n) continue;    \
+                                                                               \
+        ssize_t offset = 0;                                                    \
+        for (int d = 0; d < 256; d++) {                                        \
+            ssize_t c = count[d];                                              \
+            count[d] = offset;                                                 \
+            offset += c;                                                       \
+        }                                                                      \
+        for (ssize_t i = 0; i < n; i++)                                        \
+            to[count[(L##_radix_key(from[i]) >> shift) & 0xff]++] = from[i];   \
+                                                                               \
+        T *swap = from;                                                        \
+        from = to;                                                             \
+        to = swap;                                                             \
+    }                                                                          \
+    if (from != src) memcpy(src, from, n * sizeof(T));                         \
+    free(tmp);                                                                 \
+    return 0;                                                                  \
+}
+
+/*
+ * Generates vec_##L, a 24 byte list with no function pointers, allocator or
+ * growth policy, for embedding by value in other structs. A zeroed vec_##L
+ * is empty. It grows like a list with the default growth policy, through
+ * malloc, and pop does not shrink it. Must follow IMPORT_LIST(T, L).
+ */
+#define IMPORT_LIST_VEC(T, L)                                                  \
+typedef struct {                                                               \
+    T *data;                                                                   \
+    ssize_t size;                                                              \
+    ssize_t capacity;                                                          \
+} vec_##L;                                                                     \
+                                                                               \
+static inline int L##_vec_reserve(vec_##L *vec, ssize_t capacity)              \
+{                                                                              \
+    if (capacity <= vec->capacity) return 0;                                   \
+    T *data = (T *) realloc(vec->data, capacity * sizeof(T));                  \
+    if (!data) return MEMORY_ALLOCATION_ERR;                                   \
+    vec->data = data;                                                          \
+    vec->capacity = capacity;                                                  \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+static inline int L##_vec_grow(vec_##L *vec)                                   \
+{                                                                              \
+    return L##_vec_reserve(vec, list_next_capacity(&list_growth_default,       \
+                                                   vec->size,                  \
+                                                   vec->capacity));            \
+}                                                                              \
+                                                                               \
+static inline int L##_vec_push(vec_##L *vec, T element)                        \
+{                                                                              \
+    if (vec->size == vec->capacity) {                                          \
+        int retCode = L##_vec_grow(vec);                                       \
+        if (retCode) return retCode;                                           \
+    }                                                                          \
+    vec->data[vec->size++] = element;                                          \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+/* Removes the last element. */                                                \
+static inline int L##_vec_pop(vec_##L *vec, T *result)                         \
+{                                                                              \
+    if (!vec->size) return INDEX_OUT_OF_RANGE;                                 \
+    *result = vec->data[--vec->size];                                          \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+/* Unchecked access, for iterating over 0 <= index < vec->size. */             \
+static inline T L##_vec_at(const vec_##L *vec, ssize_t index)                  \
+{                                                                              \
+    return vec->data[index];                                                   \
+}                                                                              \
+                                                                               \
+static inline int L##_vec_get(const vec_##L *vec, ssize_t index, T *result)    \
+{                                                                              \
+    if (index < 0 || index >= vec->size) return INDEX_OUT_OF_RANGE;            \
+    *result = vec->data[index];                                                \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+static inline int L##_vec_set(vec_##L *vec, ssize_t index, T element)          \
+{                                                                              \
+    if (index < 0 || index >= vec->size) return INDEX_OUT_OF_RANGE;            \
+    vec->data[index] = element;                                                \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+/* The whole vec as a view, for find, foreach and view_slice. */               \
+static inline view_##L L##_vec_view(const vec_##L *vec)                        \
+{                                                                              \
+    view_##L view = { vec->data, vec->size, 1 };                               \
+    return view;                                                               \
+}                                                                              \
+                                                                               \
+static inline void L##_vec_sort(vec_##L *vec, compare_func cmp)                \
+{                                                                              \
+    if (vec->size > 1)                                                         \
+        L##_cmp_introsort(vec->data, vec->size, list_sort_depth(vec->size),    \
+                          cmp);                                                \
+}                                                                              \
+                                                                               \
+static inline int L##_vec_shrink_to_fit(vec_##L *vec)                          \
+{                                                                              \
+    if (vec->size == vec->capacity) return 0;                                  \
+    if (!vec->size) {                                                          \
+        free(vec->data);                                                       \
+        vec->data = NULL;                                                      \
+        vec->capacity = 0;                                                     \
+        return 0;                                                              \
+    }                                                                          \
+    T *data = (T *) realloc(vec->data, vec->size * sizeof(T));                 \
+    if (!data) return MEMORY_ALLOCATION_ERR;                                   \
+    vec->data = data;                                                          \
+    vec->capacity = vec->size;                                                 \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+/* Frees the elements and leaves an empty vec. */                              \
+static inline void L##_vec_free(vec_##L *vec)                                  \
+{                                                                              \
+    free(vec->data);                                                           \
+    vec->data = NULL;                                                          \
+    vec->size = 0;                                                             \
+    vec->capacity = 0;                                                         \
+}
+
 #endif //DATASTRUCTURES_LIST_H
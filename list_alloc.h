@@ -0,0 +1,256 @@
+// Allocators that lists can be created with through L##_new_with.
+//
+// ListArena is a bump allocator: lists built from it are never freed one by
+// one, the whole arena is rewound with list_arena_reset. ListSlab hands out
+// small blocks, such as list headers, from per-size-class free lists and
+// passes anything larger through to malloc. Neither is thread safe.
+
+#ifndef DATASTRUCTURES_LIST_ALLOC_H
+#define DATASTRUCTURES_LIST_ALLOC_H
+
+#include "list.h"
+
+/* Every block is aligned to, and rounded up to, this many bytes. */
+#define LIST_ALLOC_ALIGN 16
+
+#ifndef LIST_ARENA_BLOCK_SIZE
+#define LIST_ARENA_BLOCK_SIZE (64 * 1024)
+#endif
+
+static inline size_t list_alloc_round(size_t size)
+{
+    return (size + LIST_ALLOC_ALIGN - 1) & ~(size_t) (LIST_ALLOC_ALIGN - 1);
+}
+
+typedef struct ListArenaBlock {
+    struct ListArenaBlock *next;
+    size_t size;
+    size_t used;
+    size_t pad;
+} ListArenaBlock;
+
+typedef struct {
+    ListAllocator allocator;
+    ListArenaBlock *first;
+    ListArenaBlock *current;
+    size_t block_size;
+    /* The newest allocation, which can grow or shrink in place. */
+    char *last;
+} ListArena;
+
+static inline char *list_arena_base(ListArenaBlock *block)
+{
+    return (char *) (block + 1);
+}
+
+static void *list_arena_allocate(void *ctx, size_t size)
+{
+    ListArena *arena = (ListArena *) ctx;
+    size = list_alloc_round(size ? size : 1);
+
+    ListArenaBlock *block = arena->current;
+    while (block && block->size - block->used < size) {
+        block = block->next;
+        if (block) block->used = 0;
+    }
+    if (!block) {
+        size_t block_size = size > arena->block_size ? size : arena->block_size;
+        block = (ListArenaBlock *) malloc(sizeof(ListArenaBlock) + block_size);
+        if (!block) return NULL;
+        block->size = block_size;
+        block->used = 0;
+        /* Keep the blocks after current, they are reused after a reset. */
+        if (arena->current) {
+            block->next = arena->current->next;
+            arena->current->next = block;
+        } else {
+            block->next = NULL;
+            arena->first = block;
+        }
+    }
+    arena->current = block;
+    arena->last = list_arena_base(block) + block->used;
+    block->used += size;
+    return arena->last;
+}
+
+static void *list_arena_reallocate(void *ctx, void *ptr, size_t old_size,
+                                   size_t new_size)
+{
+    ListArena *arena = (ListArena *) ctx;
+    if (!ptr) return list_arena_allocate(ctx, new_size);
+
+    ListArenaBlock *block = arena->current;
+    if ((char *) ptr == arena->last) {
+        size_t offset = (size_t) (arena->last - list_arena_base(block));
+        size_t size = list_alloc_round(new_size ? new_size : 1);
+        if (size <= block->size - offset) {
+            block->used = offset + size;
+            return ptr;
+        }
+    }
+
+    void *result = list_arena_allocate(ctx, new_size);
+    if (result) memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+    return result;
+}
+
+/* Only the newest allocation is given back; the rest wait for a reset. */
+static void list_arena_release(void *ctx, void *ptr, size_t size)
+{
+    ListArena *arena = (ListArena *) ctx;
+    (void) size;
+    if (ptr && (char *) ptr == arena->last) {
+        arena->current->used = (size_t) (arena->last
+                                         - list_arena_base(arena->current));
+        arena->last = NULL;
+    }
+}
+
+/* block_size of 0 uses LIST_ARENA_BLOCK_SIZE. */
+static inline void list_arena_init(ListArena *arena, size_t block_size)
+{
+    arena->allocator.allocate = list_arena_allocate;
+    arena->allocator.reallocate = list_arena_reallocate;
+    arena->allocator.release = list_arena_release;
+    arena->allocator.ctx = arena;
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->block_size = block_size ? block_size : LIST_ARENA_BLOCK_SIZE;
+    arena->last = NULL;
+}
+
+/* Frees every list made from the arena at once, keeping its blocks. */
+static inline void list_arena_reset(ListArena *arena)
+{
+    arena->current = arena->first;
+    if (arena->current) arena->current->used = 0;
+    arena->last = NULL;
+}
+
+/* Returns the arena's blocks to malloc. */
+static inline void list_arena_destroy(ListArena *arena)
+{
+    ListArenaBlock *block = arena->first;
+    while (block) {
+        ListArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->last = NULL;
+}
+
+/*
+ * Size classes are LIST_ALLOC_ALIGN bytes apart, up to LIST_SLAB_MAX. 384
+ * bytes holds a list header with or without LIST_STATS, so both builds put
+ * headers in the slab.
+ */
+#define LIST_SLAB_CLASSES 24
+#define LIST_SLAB_MAX (LIST_SLAB_CLASSES * LIST_ALLOC_ALIGN)
+
+#ifndef LIST_SLAB_CHUNK_SIZE
+#define LIST_SLAB_CHUNK_SIZE (64 * 1024)
+#endif
+
+typedef struct ListSlabChunk {
+    struct ListSlabChunk *next;
+    size_t pad;
+} ListSlabChunk;
+
+typedef struct {
+    ListAllocator allocator;
+    void *free_lists[LIST_SLAB_CLASSES];
+    ListSlabChunk *chunks;
+    char *cursor;
+    char *end;
+} ListSlab;
+
+static inline int list_slab_class(size_t size)
+{
+    return size ? (int) ((size - 1) / LIST_ALLOC_ALIGN) : 0;
+}
+
+static void *list_slab_allocate(void *ctx, size_t size)
+{
+    ListSlab *slab = (ListSlab *) ctx;
+    if (size > LIST_SLAB_MAX) return malloc(size);
+
+    int cls = list_slab_class(size);
+    void *block = slab->free_lists[cls];
+    if (block) {
+        memcpy(&slab->free_lists[cls], block, sizeof(void *));
+        return block;
+    }
+
+    size = (size_t) (cls + 1) * LIST_ALLOC_ALIGN;
+    if ((size_t) (slab->end - slab->cursor) < size) {
+        ListSlabChunk *chunk = (ListSlabChunk *) malloc(sizeof(ListSlabChunk)
+                                                        + LIST_SLAB_CHUNK_SIZE);
+        if (!chunk) return NULL;
+        chunk->next = slab->chunks;
+        slab->chunks = chunk;
+        slab->cursor = (char *) (chunk + 1);
+        slab->end = slab->cursor + LIST_SLAB_CHUNK_SIZE;
+    }
+    block = slab->cursor;
+    slab->cursor += size;
+    return block;
+}
+
+static void list_slab_release(void *ctx, void *ptr, size_t size)
+{
+    ListSlab *slab = (ListSlab *) ctx;
+    if (!ptr) return;
+    if (size > LIST_SLAB_MAX) {
+        free(ptr);
+        return;
+    }
+    int cls = list_slab_class(size);
+    memcpy(ptr, &slab->free_lists[cls], sizeof(void *));
+    slab->free_lists[cls] = ptr;
+}
+
+static void *list_slab_reallocate(void *ctx, void *ptr, size_t old_size,
+                                  size_t new_size)
+{
+    if (!ptr) return list_slab_allocate(ctx, new_size);
+    if (old_size > LIST_SLAB_MAX && new_size > LIST_SLAB_MAX)
+        return realloc(ptr, new_size);
+    if (old_size <= LIST_SLAB_MAX && new_size <= LIST_SLAB_MAX
+        && list_slab_class(old_size) == list_slab_class(new_size))
+        return ptr;
+
+    void *result = list_slab_allocate(ctx, new_size);
+    if (!result) return NULL;
+    memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+    list_slab_release(ctx, ptr, old_size);
+    return result;
+}
+
+static inline void list_slab_init(ListSlab *slab)
+{
+    memset(slab, 0, sizeof(*slab));
+    slab->allocator.allocate = list_slab_allocate;
+    slab->allocator.reallocate = list_slab_reallocate;
+    slab->allocator.release = list_slab_release;
+    slab->allocator.ctx = slab;
+}
+
+/*
+ * Returns the slab's chunks to malloc. Lists still holding blocks larger
+ * than LIST_SLAB_MAX must be destroyed first, those came from malloc.
+ */
+static inline void list_slab_destroy(ListSlab *slab)
+{
+    ListSlabChunk *chunk = slab->chunks;
+    while (chunk) {
+        ListSlabChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    list_slab_init(slab);
+}
+
+#endif //DATASTRUCTURES_LIST_ALLOC_H
@@ -0,0 +1,334 @@
+// Lists that many threads can append to at once.
+//
+// IMPORT_CONCURRENT_LIST(T, L) adds two flavours next to the ordinary L.
+// concurrent_##L is lock free: append reserves an index with one atomic add
+// and writes into a segmented store whose segments double in size and are
+// never moved, so a published element stays where it is. sharded_##L keeps
+// one ordinary list per shard behind its own mutex and spreads threads over
+// the shards. Both are turned back into an ordinary L when producers finish.
+
+#ifndef DATASTRUCTURES_LIST_CONCURRENT_H
+#define DATASTRUCTURES_LIST_CONCURRENT_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "list.h"
+
+/* Segment k holds LIST_CONCURRENT_FIRST << k elements. */
+#define LIST_CONCURRENT_FIRST_BITS 10
+#define LIST_CONCURRENT_FIRST ((ssize_t) 1 << LIST_CONCURRENT_FIRST_BITS)
+#define LIST_CONCURRENT_SEGMENTS 40
+
+/* Added to the reserve counter by freeze, so later appends can tell. */
+#define LIST_CONCURRENT_FROZEN ((ssize_t) 1 << 60)
+
+/* Which segment holds index, and where in it. */
+static inline int list_concurrent_locate(ssize_t index, ssize_t *offset)
+{
+    size_t pos = (size_t) index + (size_t) LIST_CONCURRENT_FIRST;
+    int top = 0;
+#if defined(__GNUC__)
+    top = 63 - __builtin_clzll((unsigned long long) pos);
+#else
+    while (pos >> (top + 1)) top++;
+#endif
+    *offset = (ssize_t) (pos - ((size_t) 1 << top));
+    return top - LIST_CONCURRENT_FIRST_BITS;
+}
+
+static inline ssize_t list_concurrent_segment_size(int segment)
+{
+    return LIST_CONCURRENT_FIRST << segment;
+}
+
+/* A small number that stays the same for the life of the calling thread. */
+static inline unsigned list_concurrent_thread_id(void)
+{
+    static _Atomic unsigned next;
+    static _Thread_local unsigned id;
+    if (!id) id = atomic_fetch_add(&next, 1) + 1;
+    return id - 1;
+}
+
+/* Must follow IMPORT_LIST(T, L). */
+#define IMPORT_CONCURRENT_LIST(T, L)                                           \
+typedef struct _concurrent_##L                                                 \
+{                                                                              \
+    /* The next index to hand out, alone on its cache line. */                 \
+    _Alignas(64) _Atomic ssize_t reserved;                                     \
+    _Alignas(64) _Atomic int failed;                                           \
+    /* Each segment's elements, followed by one ready flag per element. */     \
+    T *_Atomic segments[LIST_CONCURRENT_SEGMENTS];                             \
+} *concurrent_##L;                                                             \
+                                                                               \
+static inline _Atomic unsigned char *L##_concurrent_flags(T *segment, int k)   \
+{                                                                              \
+    return (_Atomic unsigned char *) (segment                                  \
+                                      + list_concurrent_segment_size(k));      \
+}                                                                              \
+                                                                               \
+static inline concurrent_##L L##_concurrent_new()                              \
+{                                                                              \
+    concurrent_##L list = (concurrent_##L) aligned_alloc(                      \
+            64, sizeof(struct _concurrent_##L));                               \
+    if (!list) return NULL;                                                    \
+    atomic_init(&list->reserved, 0);                                           \
+    atomic_init(&list->failed, 0);                                             \
+    for (int k = 0; k < LIST_CONCURRENT_SEGMENTS; k++)                         \
+        atomic_init(&list->segments[k], NULL);                                 \
+    return list;                                                               \
+}                                                                              \
+                                                                               \
+/* Returns segment k, allocating it if this is the first thread to need it. */ \
+static inline T *L##_concurrent_segment(concurrent_##L list, int k)            \
+{                                                                              \
+    T *segment = atomic_load_explicit(&list->segments[k],                      \
+                                      memory_order_acquire);                   \
+    if (segment) return segment;                                               \
+                                                                               \
+    ssize_t count = list_concurrent_segment_size(k);                           \
+    T *fresh = (T *) calloc(1, (size_t) count * (sizeof(T) + 1));              \
+    if (!fresh) return NULL;                                                   \
+    if (atomic_compare_exchange_strong_explicit(&list->segments[k], &segment,  \
+                                                fresh, memory_order_acq_rel,   \
+                                                memory_order_acquire))         \
+        return fresh;                                                          \
+    free(fresh);                                                               \
+    return segment;                                                            \
+}                                                                              \
+                                                                               \
+/*                                                                             \
+ * Safe to call from any number of threads. Returns FROZEN_LIST_ERR once the   \
+ * list has been frozen. If a segment cannot be allocated the element is lost  \
+ * and the list can then only be snapshotted.                                  \
+ */                                                                            \
+static inline int L##_concurrent_append(concurrent_##L list, T element)        \
+{                                                                              \
+    ssize_t index = atomic_fetch_add_explicit(&list->reserved, 1,              \
+                                              memory_order_relaxed);           \
+    if (index >= LIST_CONCURRENT_FROZEN) {                                     \
+        atomic_fetch_sub_explicit(&list->reserved, 1, memory_order_relaxed);   \
+        return FROZEN_LIST_ERR;                                                \
+    }                                                                          \
+                                                                               \
+    ssize_t offset;                                                            \
+    int k = list_concurrent_locate(index, &offset);                            \
+    T *segment = k < LIST_CONCURRENT_SEGMENTS                                  \
+                 ? L##_concurrent_segment(list, k) : NULL;                     \
+    if (!segment) {                                                            \
+        atomic_store(&list->failed, 1);                                        \
+        return MEMORY_ALLOCATION_ERR;                                          \
+    }                                                                          \
+    segment[offset] = element;                                                 \
+    atomic_store_explicit(&L##_concurrent_flags(segment, k)[offset], 1,        \
+                          memory_order_release);                               \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+/* Elements reserved so far, some of which may still be being written. */      \
+static inline ssize_t L##_concurrent_len(concurrent_##L list)                  \
+{                                                                              \
+    ssize_t reserved = atomic_load(&list->reserved);                           \
+    return reserved >= LIST_CONCURRENT_FROZEN                                  \
+           ? reserved - LIST_CONCURRENT_FROZEN : reserved;                     \
+}                                                                              \
+                                                                               \
+/* Reads a published element; INDEX_OUT_OF_RANGE if it is not written yet. */  \
+static inline int L##_concurrent_get(concurrent_##L list, ssize_t index,       \
+                                      T *result)                               \
+{                                                                              \
+    if (index < 0 || index >= L##_concurrent_len(list))                        \
+        return INDEX_OUT_OF_RANGE;                                             \
+    ssize_t offset;                                                            \
+    int k = list_concurrent_locate(index, &offset);                            \
+    T *segment = atomic_load_explicit(&list->segments[k],                      \
+                                      memory_order_acquire);                   \
+    if (!segment                                                               \
+        || !atomic_load_explicit(&L##_concurrent_flags(segment, k)[offset],    \
+                                 memory_order_acquire))                        \
+        return INDEX_OUT_OF_RANGE;                                             \
+    *result = segment[offset];                                                 \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+/*                                                                             \
+ * Copies the first count elements into a new ordinary list. If wait is set,   \
+ * unwritten elements are waited for, otherwise the copy stops at the first.   \
+ */                                                                            \
+static inline int L##_concurrent_copy(concurrent_##L list, ssize_t count,      \
+                                      int wait, L *result)                     \
+{                                                                              \
+    L copy = L##_new();                                                        \
+    if (!copy) return MEMORY_ALLOCATION_ERR;                                   \
+    int retCode = L##_set_capacity(copy, count);                               \
+                                                                               \
+    for (int k = 0; !retCode && copy->size < count; k++) {                     \
+        T *segment = atomic_load_explicit(&list->segments[k],                  \
+                                          memory_order_acquire);               \
+        _Atomic unsigned char *flags = segment                                 \
+                                       ? L##_concurrent_flags(segment, k)      \
+                                       : NULL;                                 \
+        ssize_t want = count - copy->size;                                     \
+        if (want > list_concurrent_segment_size(k))                            \
+            want = list_concurrent_segment_size(k);                            \
+                                                                               \
+        ssize_t ready = 0;                                                     \
+        while (ready < want) {                                                 \
+            if (flags && atomic_load_explicit(&flags[ready],                   \
+                                              memory_order_acquire)) {         \
+                ready++;                                                       \
+                continue;                                                      \
+            }                                                                  \
+            if (!wait || atomic_load(&list->failed)) break;                    \
+            sched_yield();                                                     \
+            if (!segment) {                                                    \
+                segment = atomic_load_explicit(&list->segments[k],             \
+                                               memory_order_acquire);          \
+                if (segment) flags = L##_concurrent_flags(segment, k);         \
+            }                                                                  \
+        }                                                                      \
+        if (ready) retCode = L##_append_n(copy, segment, ready);               \
+        if (ready < want) break;                                               \
+    }                                                                          \
+    if (!retCode && wait && copy->size < count)                                \
+        retCode = MEMORY_ALLOCATION_ERR;                                       \
+    if (retCode) {                                                             \
+        L##_destroy(copy);                                                     \
+        return retCode;                                                        \
+    }                                                                          \
+    *result = copy;                                                            \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+/*                                                                             \
+ * Copies every element published so far, up to the first one still being      \
+ * written, into a new ordinary list. Producers may keep appending.            \
+ */                                                                            \
+static inline int L##_concurrent_snapshot(concurrent_##L list, L *result)      \
+{                                                                              \
+    if (!list || !result) return UNINITIALISED_ARRAY;                          \
+    return L##_concurrent_copy(list, L##_concurrent_len(list), 0, result);     \
+}                                                                              \
+                                                                               \
+/*                                                                             \
+ * Stops further appends, waits for those in flight and copies everything      \
+ * into a new ordinary list, in index order. Appends after this return         \
+ * FROZEN_LIST_ERR. Fails with MEMORY_ALLOCATION_ERR if an append lost an      \
+ * element.                                                                    \
+ */                                                                            \
+static inline int L##_concurrent_freeze(concurrent_##L list, L *result)        \
+{                                                                              \
+    if (!list || !result) return UNINITIALISED_ARRAY;                          \
+    ssize_t count = atomic_load(&list->reserved);                              \
+    while (count < LIST_CONCURRENT_FROZEN                                      \
+           && !atomic_compare_exchange_weak(&list->reserved, &count,           \
+                                            count + LIST_CONCURRENT_FROZEN))   \
+        ;                                                                      \
+    if (count >= LIST_CONCURRENT_FROZEN) count -= LIST_CONCURRENT_FROZEN;      \
+    return L##_concurrent_copy(list, count, 1, result);                        \
+}                                                                              \
+                                                                               \
+/* No other thread may be using the list. */                                   \
+static inline void L##_concurrent_destroy(concurrent_##L list)                 \
+{                                                                              \
+    if (!list) return;                                                         \
+    for (int k = 0; k < LIST_CONCURRENT_SEGMENTS; k++)                         \
+        free(atomic_load(&list->segments[k]));                                 \
+    free(list);                                                                \
+}                                                                              \
+                                                                               \
+typedef struct                                                                 \
+{                                                                              \
+    _Alignas(64) pthread_mutex_t lock;                                         \
+    L list;                                                                    \
+} sharded_shard_##L;                                                           \
+                                                                               \
+typedef struct _sharded_##L                                                    \
+{                                                                              \
+    int shards;                                                                \
+    sharded_shard_##L *shard;                                                  \
+} *sharded_##L;                                                                \
+                                                                               \
+static inline void L##_sharded_destroy(sharded_##L list)                       \
+{                                                                              \
+    if (!list) return;                                                         \
+    for (int s = 0; s < list->shards; s++) {                                   \
+        L##_destroy(list->shard[s].list);                                      \
+        pthread_mutex_destroy(&list->shard[s].lock);                           \
+    }                                                                          \
+    free(list->shard);                                                         \
+    free(list);                                                                \
+}                                                                              \
+                                                                               \
+/* shards < 1 uses one shard per CPU. */                                       \
+static inline sharded_##L L##_sharded_new(int shards)                          \
+{                                                                              \
+    if (shards < 1) {                                                          \
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);                             \
+        shards = cpus < 1 ? 1 : (int) cpus;                                    \
+    }                                                                          \
+    sharded_##L list = (sharded_##L) malloc(sizeof(struct _sharded_##L));      \
+    if (!list) return NULL;                                                    \
+    list->shards = 0;                                                          \
+    list->shard = (sharded_shard_##L *) aligned_alloc(                         \
+            64, (size_t) shards * sizeof(sharded_shard_##L));                  \
+    if (!list->shard) {                                                        \
+        free(list);                                                            \
+        return NULL;                                                           \
+    }                                                                          \
+    for (; list->shards < shards; list->shards++) {                            \
+        sharded_shard_##L *shard = &list->shard[list->shards];                 \
+        shard->list = L##_new();                                               \
+        if (!shard->list) break;                                               \
+        pthread_mutex_init(&shard->lock, NULL);                                \
+    }                                                                          \
+    if (list->shards < shards) {                                               \
+        L##_sharded_destroy(list);                                             \
+        return NULL;                                                           \
+    }                                                                          \
+    return list;                                                               \
+}                                                                              \
+                                                                               \
+/* Safe to call from any number of threads; appends to the thread's shard. */  \
+static inline int L##_sharded_append(sharded_##L list, T element)              \
+{                                                                              \
+    sharded_shard_##L *shard = &list->shard[list_concurrent_thread_id()        \
+                                            % (unsigned) list->shards];        \
+    pthread_mutex_lock(&shard->lock);                                          \
+    int retCode = L##_append(shard->list, element);                            \
+    pthread_mutex_unlock(&shard->lock);                                        \
+    return retCode;                                                            \
+}                                                                              \
+                                                                               \
+/*                                                                             \
+ * Copies every shard, one after another, into a new ordinary list. Elements   \
+ * from one thread keep their order; the order between threads is not kept.    \
+ */                                                                            \
+static inline int L##_sharded_collect(sharded_##L list, L *result)             \
+{                                                                              \
+    if (!list || !result) return UNINITIALISED_ARRAY;                          \
+    for (int s = 0; s < list->shards; s++)                                     \
+        pthread_mutex_lock(&list->shard[s].lock);                              \
+                                                                               \
+    ssize_t count = 0;                                                         \
+    for (int s = 0; s < list->shards; s++) count += list->shard[s].list->size; \
+    L copy = L##_new();                                                        \
+    int retCode = copy ? L##_set_capacity(copy, count)                         \
+                       : MEMORY_ALLOCATION_ERR;                                \
+    for (int s = 0; s < list->shards && !retCode; s++)                         \
+        retCode = L##_extend(copy, list->shard[s].list);                       \
+                                                                               \
+    for (int s = 0; s < list->shards; s++)                                     \
+        pthread_mutex_unlock(&list->shard[s].lock);                            \
+    if (retCode) {                                                             \
+        if (copy) L##_destroy(copy);                                           \
+        return retCode;                                                        \
+    }                                                                          \
+    *result = copy;                                                            \
+    return 0;                                                                  \
+}
+
+#endif //DATASTRUCTURES_LIST_CONCURRENT_H
@@ -0,0 +1,354 @@
+// Saving lists to disk and opening them again without rebuilding them.
+//
+// A list file is a 64 byte ListFileHeader followed by the raw elements, in
+// the byte order and layout of the machine that wrote it. save streams the
+// elements out in large writes, load reads them back into a normal list and
+// open maps the file so that the list's data points straight into the page
+// cache. Needs POSIX (open, read, write, mmap).
+
+#ifndef DATASTRUCTURES_LIST_FILE_H
+#define DATASTRUCTURES_LIST_FILE_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "list.h"
+
+#define LIST_FILE_MAGIC "DSLIST\0\0"
+#define LIST_FILE_VERSION 1
+
+/* Bytes per read or write call. */
+#ifndef LIST_FILE_CHUNK
+#define LIST_FILE_CHUNK (8 * 1024 * 1024)
+#endif
+
+/* Modes for L##_open. */
+#define LIST_FILE_READONLY 0
+#define LIST_FILE_COPY_ON_WRITE 1
+/* May be or-ed into the mode to check the checksum, which reads every page. */
+#define LIST_FILE_VERIFY 2
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t element_size;
+    uint64_t count;
+    uint64_t checksum;
+    uint8_t reserved[24];
+} ListFileHeader;
+
+/* A 64 bit hash over four independent lanes, so it runs near memory speed. */
+static inline uint64_t list_file_checksum(const void *data, size_t size)
+{
+    const uint64_t prime = 0x9E3779B97F4A7C15ULL;
+    const unsigned char *bytes = (const unsigned char *) data;
+    uint64_t lane[4] = {
+        0x243F6A8885A308D3ULL, 0x13198A2E03707344ULL,
+        0xA4093822299F31D0ULL, 0x082EFA98EC4E6C89ULL
+    };
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t word;
+            memcpy(&word, bytes + i + 8 * l, sizeof(word));
+            lane[l] = (lane[l] ^ word) * prime;
+            lane[l] ^= lane[l] >> 29;
+        }
+    }
+    for (; i < size; i++) lane[0] = (lane[0] ^ bytes[i]) * prime;
+
+    uint64_t hash = (uint64_t) size;
+    for (int l = 0; l < 4; l++) {
+        hash = (hash ^ lane[l]) * prime;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+static inline int list_file_write_all(int fd, const void *data, size_t size)
+{
+    const char *bytes = (const char *) data;
+    while (size) {
+        size_t chunk = size < LIST_FILE_CHUNK ? size : LIST_FILE_CHUNK;
+        ssize_t written = write(fd, bytes, chunk);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return FILE_IO_ERR;
+        }
+        bytes += written;
+        size -= (size_t) written;
+    }
+    return 0;
+}
+
+static inline int list_file_read_all(int fd, void *data, size_t size)
+{
+    char *bytes = (char *) data;
+    while (size) {
+        size_t chunk = size < LIST_FILE_CHUNK ? size : LIST_FILE_CHUNK;
+        ssize_t got = read(fd, bytes, chunk);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            return FILE_IO_ERR;
+        }
+        if (got == 0) return FILE_FORMAT_ERR;
+        bytes += got;
+        size -= (size_t) got;
+    }
+    return 0;
+}
+
+/*
+ * Writes header and data to path + ".tmp", syncs it and renames it over path,
+ * so a crash leaves either the old file or the new one. It also keeps the
+ * old file's pages alive for any list still mapping it, which may be the
+ * very list being saved.
+ */
+static inline int list_file_replace(const char *path, const void *header,
+                                    size_t header_size, const void *data,
+                                    size_t size)
+{
+    size_t length = strlen(path);
+    char *temp = (char *) malloc(length + sizeof(".tmp"));
+    if (!temp) return MEMORY_ALLOCATION_ERR;
+    memcpy(temp, path, length);
+    memcpy(temp + length, ".tmp", sizeof(".tmp"));
+
+    int retCode = 0;
+    int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) retCode = FILE_IO_ERR;
+    if (!retCode) retCode = list_file_write_all(fd, header, header_size);
+    if (!retCode) retCode = list_file_write_all(fd, data, size);
+    if (!retCode && fsync(fd)) retCode = FILE_IO_ERR;
+    if (fd >= 0 && close(fd) && !retCode) retCode = FILE_IO_ERR;
+    if (!retCode && rename(temp, path)) retCode = FILE_IO_ERR;
+    if (retCode && fd >= 0) unlink(temp);
+    free(temp);
+    return retCode;
+}
+
+/* Checks everything in a header except the checksum. */
+static inline int list_file_check(const ListFileHeader *header,
+                                  size_t element_size, uint64_t file_size)
+{
+    if (memcmp(header->magic, LIST_FILE_MAGIC, sizeof(header->magic))
+        || header->version != LIST_FILE_VERSION
+        || header->header_size != sizeof(ListFileHeader)
+        || header->element_size != element_size)
+        return FILE_FORMAT_ERR;
+    if (header->count > (file_size - sizeof(ListFileHeader)) / element_size
+        || file_size != sizeof(ListFileHeader) + header->count * element_size)
+        return FILE_FORMAT_ERR;
+    return 0;
+}
+
+/*
+ * The allocator behind an opened list, and behind any slice taken from it.
+ * The list's data stays in the mapping until something reallocates it,
+ * which copies it to the heap; everything else comes from malloc. The map
+ * counts the blocks it has handed out and frees itself once the last one is
+ * released and the mapping is gone.
+ */
+typedef struct {
+    ListAllocator allocator;
+    void *map;
+    size_t map_size;
+    void *data;
+    /* Headers and heap buffers handed out and not yet released. */
+    size_t blocks;
+} ListFileMap;
+
+static inline void list_file_map_unmap(ListFileMap *map)
+{
+    if (!map->map) return;
+    munmap(map->map, map->map_size);
+    map->map = NULL;
+    map->data = NULL;
+}
+
+static inline void list_file_map_drop(ListFileMap *map)
+{
+    if (!map->blocks && !map->map) free(map);
+}
+
+static inline void *list_file_map_allocate(void *ctx, size_t size)
+{
+    ListFileMap *map = (ListFileMap *) ctx;
+    void *result = malloc(size);
+    if (result) map->blocks++;
+    return result;
+}
+
+static inline void *list_file_map_reallocate(void *ctx, void *ptr,
+                                             size_t old_size, size_t new_size)
+{
+    ListFileMap *map = (ListFileMap *) ctx;
+    if (ptr && ptr != map->data) return realloc(ptr, new_size);
+
+    void *result = malloc(new_size);
+    if (!result) return NULL;
+    map->blocks++;
+    if (ptr) {
+        memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+        list_file_map_unmap(map);
+    }
+    return result;
+}
+
+static inline void list_file_map_release(void *ctx, void *ptr, size_t size)
+{
+    ListFileMap *map = (ListFileMap *) ctx;
+    (void) size;
+    if (!ptr) return;
+    if (ptr == map->data) {
+        list_file_map_unmap(map);
+    } else {
+        free(ptr);
+        map->blocks--;
+    }
+    list_file_map_drop(map);
+}
+
+/* Must follow IMPORT_LIST(T, L). */
+#define IMPORT_LIST_FILE(T, L)                                                 \
+/* Writes the list to path, replacing any existing file in one step. */        \
+static inline int L##_save(L list, const char *path)                           \
+{                                                                              \
+    if (!list || !path) return UNINITIALISED_ARRAY;                            \
+                                                                               \
+    size_t bytes = (size_t) list->size * sizeof(T);                            \
+    ListFileHeader header;                                                     \
+    memset(&header, 0, sizeof(header));                                        \
+    memcpy(header.magic, LIST_FILE_MAGIC, sizeof(header.magic));               \
+    header.version = LIST_FILE_VERSION;                                        \
+    header.header_size = sizeof(ListFileHeader);                               \
+    header.element_size = sizeof(T);                                           \
+    header.count = (uint64_t) list->size;                                      \
+    header.checksum = list_file_checksum(list->data, bytes);                   \
+                                                                               \
+    return list_file_replace(path, &header, sizeof(header), list->data,        \
+                             bytes);                                           \
+}                                                                              \
+                                                                               \
+/* Reads a saved list into a new list made with allocator (NULL: malloc). */   \
+static inline int L##_load(const char *path, const ListAllocator *allocator,   \
+                           L *result)                                          \
+{                                                                              \
+    if (!path || !result) return UNINITIALISED_ARRAY;                          \
+    *result = NULL;                                                            \
+                                                                               \
+    int fd = open(path, O_RDONLY);                                             \
+    if (fd < 0) return FILE_IO_ERR;                                            \
+    struct stat st;                                                            \
+    ListFileHeader header;                                                     \
+    int retCode = fstat(fd, &st) ? FILE_IO_ERR : 0;                            \
+    if (!retCode && (uint64_t) st.st_size < sizeof(header))                    \
+        retCode = FILE_FORMAT_ERR;                                             \
+    if (!retCode) retCode = list_file_read_all(fd, &header, sizeof(header));   \
+    if (!retCode)                                                              \
+        retCode = list_file_check(&header, sizeof(T), (uint64_t) st.st_size);  \
+                                                                               \
+    size_t bytes = (size_t) header.count * sizeof(T);                          \
+    L list = NULL;                                                             \
+    if (!retCode) {                                                            \
+        list = L##_new_with(allocator);                                        \
+        if (!list) retCode = MEMORY_ALLOCATION_ERR;                            \
+    }                                                                          \
+    if (!retCode && header.count)                                              \
+        retCode = L##_set_capacity(list, (ssize_t) header.count);              \
+    if (!retCode)                                                              \
+        retCode = list_file_read_all(fd, list->data, bytes);                   \
+    close(fd);                                                                 \
+                                                                               \
+    if (!retCode && list_file_checksum(list->data, bytes) != header.checksum)  \
+        retCode = FILE_FORMAT_ERR;                                             \
+    if (retCode) {                                                             \
+        if (list) L##_destroy(list);                                           \
+        return retCode;                                                        \
+    }                                                                          \
+    list->size = (ssize_t) header.count;                                       \
+    *result = list;                                                            \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+/*                                                                             \
+ * Maps a saved list. The list's data points into the mapping, so opening      \
+ * costs the same whatever the size. LIST_FILE_READONLY maps the file shared   \
+ * and read only: writing to an element faults. LIST_FILE_COPY_ON_WRITE maps   \
+ * it privately, so set and sort change only this process's pages. Either      \
+ * way, anything that reallocates the list (append, pop, reserve, ...) first   \
+ * copies the data to the heap. destroy unmaps the file.                       \
+ */                                                                            \
+static inline int L##_open(const char *path, int mode, L *result)              \
+{                                                                              \
+    if (!path || !result) return UNINITIALISED_ARRAY;                          \
+    *result = NULL;                                                            \
+                                                                               \
+    int fd = open(path, O_RDONLY);                                             \
+    if (fd < 0) return FILE_IO_ERR;                                            \
+    struct stat st;                                                            \
+    if (fstat(fd, &st)) {                                                      \
+        close(fd);                                                             \
+        return FILE_IO_ERR;                                                    \
+    }                                                                          \
+    if ((uint64_t) st.st_size < sizeof(ListFileHeader)) {                      \
+        close(fd);                                                             \
+        return FILE_FORMAT_ERR;                                                \
+    }                                                                          \
+                                                                               \
+    int cow = (mode & LIST_FILE_COPY_ON_WRITE) != 0;                           \
+    size_t map_size = (size_t) st.st_size;                                     \
+    void *mapped = mmap(NULL, map_size, cow ? PROT_READ | PROT_WRITE           \
+                                            : PROT_READ,                       \
+                        cow ? MAP_PRIVATE : MAP_SHARED, fd, 0);                \
+    close(fd);                                                                 \
+    if (mapped == MAP_FAILED) return FILE_IO_ERR;                              \
+                                                                               \
+    const ListFileHeader *header = (const ListFileHeader *) mapped;            \
+    T *data = (T *) ((char *) mapped + sizeof(ListFileHeader));                \
+    int retCode = list_file_check(header, sizeof(T), (uint64_t) map_size);     \
+    if (!retCode && (mode & LIST_FILE_VERIFY)                                  \
+        && list_file_checksum(data, header->count * sizeof(T))                 \
+           != header->checksum)                                                \
+        retCode = FILE_FORMAT_ERR;                                             \
+                                                                               \
+    ListFileMap *map = NULL;                                                   \
+    if (!retCode) {                                                            \
+        map = (ListFileMap *) calloc(1, sizeof(ListFileMap));                  \
+        if (!map) retCode = MEMORY_ALLOCATION_ERR;                             \
+    }                                                                          \
+    if (retCode) {                                                             \
+        munmap(mapped, map_size);                                              \
+        return retCode;                                                        \
+    }                                                                          \
+    map->allocator.allocate = list_file_map_allocate;                          \
+    map->allocator.reallocate = list_file_map_reallocate;                      \
+    map->allocator.release = list_file_map_release;                            \
+    map->allocator.ctx = map;                                                  \
+    map->map = mapped;                                                         \
+    map->map_size = map_size;                                                  \
+                                                                               \
+    L list = L##_new_with(&map->allocator);                                    \
+    if (!list) {                                                               \
+        munmap(mapped, map_size);                                              \
+        free(map);                                                             \
+        return MEMORY_ALLOCATION_ERR;                                          \
+    }                                                                          \
+    if (header->count) {                                                       \
+        map->data = data;                                                      \
+        list->data = data;                                                     \
+        list->size = (ssize_t) header->count;                                  \
+        list->capacity = list->size;                                           \
+    } else {                                                                   \
+        list_file_map_unmap(map);                                              \
+    }                                                                          \
+    *result = list;                                                            \
+    return 0;                                                                  \
+}
+
+#endif //DATASTRUCTURES_LIST_FILE_H
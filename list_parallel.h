@@ -0,0 +1,459 @@
+// Parallel sort, find and foreach for lists generated by IMPORT_LIST.
+//
+// The work runs on a ListPool: a small fork-join pthread pool whose workers
+// own a range of task indices each and steal half of another worker's
+// remaining range when their own runs out. The calling thread takes part as
+// worker 0, so a pool of one thread runs everything inline.
+
+#ifndef DATASTRUCTURES_LIST_PARALLEL_H
+#define DATASTRUCTURES_LIST_PARALLEL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "list.h"
+
+/* Below this many elements the parallel calls use the serial versions. */
+#ifndef LIST_PARALLEL_CUTOFF
+#define LIST_PARALLEL_CUTOFF 65536
+#endif
+
+/* Elements handed to a worker at a time by pfind and pforeach. */
+#ifndef LIST_PARALLEL_GRAIN
+#define LIST_PARALLEL_GRAIN 16384
+#endif
+
+typedef void (*list_task_func)(void *arg, ssize_t task);
+
+typedef struct {
+    pthread_mutex_t lock;
+    ssize_t next;
+    ssize_t end;
+} ListPoolQueue;
+
+typedef struct ListPool {
+    int threads;
+    pthread_t *workers;
+    ListPoolQueue *queues;
+
+    pthread_mutex_t run_lock;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    unsigned long generation;
+    int active;
+    int stop;
+
+    list_task_func func;
+    void *arg;
+} ListPool;
+
+typedef struct {
+    ListPool *pool;
+    int id;
+} ListPoolWorker;
+
+/* Takes one task from the worker's own range, stealing if it is empty. */
+static inline int list_pool_take(ListPool *pool, int id, ssize_t *task)
+{
+    ListPoolQueue *own = &pool->queues[id];
+    for (;;) {
+        pthread_mutex_lock(&own->lock);
+        if (own->next < own->end) {
+            *task = own->next++;
+            pthread_mutex_unlock(&own->lock);
+            return 1;
+        }
+        pthread_mutex_unlock(&own->lock);
+
+        /* Only one lock is held at a time, so thieves cannot deadlock. */
+        ssize_t lo = 0;
+        ssize_t hi = 0;
+        for (int k = 1; k < pool->threads && lo == hi; k++) {
+            ListPoolQueue *victim = &pool->queues[(id + k) % pool->threads];
+            pthread_mutex_lock(&victim->lock);
+            ssize_t left = victim->end - victim->next;
+            if (left > 0) {
+                hi = victim->end;
+                victim->end -= (left + 1) / 2;
+                lo = victim->end;
+            }
+            pthread_mutex_unlock(&victim->lock);
+        }
+        if (lo == hi) return 0;
+
+        pthread_mutex_lock(&own->lock);
+        own->next = lo;
+        own->end = hi;
+        pthread_mutex_unlock(&own->lock);
+    }
+}
+
+static inline void list_pool_drain(ListPool *pool, int id)
+{
+    ssize_t task;
+    while (list_pool_take(pool, id, &task)) pool->func(pool->arg, task);
+}
+
+static void *list_pool_main(void *arg)
+{
+    ListPoolWorker *self = (ListPoolWorker *) arg;
+    ListPool *pool = self->pool;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->generation == seen)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->stop) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        list_pool_drain(pool, self->id);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0) pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    free(self);
+    return NULL;
+}
+
+static inline void list_pool_destroy(ListPool *pool)
+{
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->threads; i++)
+        if (pool->workers[i]) pthread_join(pool->workers[i], NULL);
+    for (int i = 0; i < pool->threads; i++)
+        pthread_mutex_destroy(&pool->queues[i].lock);
+
+    pthread_mutex_destroy(&pool->run_lock);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+    free(pool->workers);
+    free(pool->queues);
+    free(pool);
+}
+
+/*
+ * Creates a pool of `threads` workers, counting the caller. A value below 1
+ * uses one worker per online CPU.
+ */
+static inline ListPool *list_pool_new(int threads)
+{
+    if (threads < 1) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int) cpus : 1;
+    }
+
+    ListPool *pool = (ListPool *) calloc(1, sizeof(ListPool));
+    if (!pool) return NULL;
+    pool->threads = threads;
+    pool->workers = (pthread_t *) calloc(threads, sizeof(pthread_t));
+    pool->queues = (ListPoolQueue *) calloc(threads, sizeof(ListPoolQueue));
+    if (!pool->workers || !pool->queues) {
+        free(pool->workers);
+        free(pool->queues);
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->run_lock, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (int i = 0; i < threads; i++)
+        pthread_mutex_init(&pool->queues[i].lock, NULL);
+
+    for (int i = 1; i < threads; i++) {
+        ListPoolWorker *worker = (ListPoolWorker *) malloc(sizeof(*worker));
+        if (worker) {
+            worker->pool = pool;
+            worker->id = i;
+        }
+        if (!worker || pthread_create(&pool->workers[i], NULL,
+                                      list_pool_main, worker)) {
+            free(worker);
+            pool->threads = i;
+            list_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+/*
+ * Runs func(arg, i) for every i in [0, tasks) and returns once all of them
+ * have finished. Tasks must not call back into the same pool.
+ */
+static inline void list_pool_run(ListPool *pool, list_task_func func,
+                                 void *arg, ssize_t tasks)
+{
+    if (tasks <= 0) return;
+    if (pool->threads == 1 || tasks == 1) {
+        for (ssize_t i = 0; i < tasks; i++) func(arg, i);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->run_lock);
+    pthread_mutex_lock(&pool->lock);
+    pool->func = func;
+    pool->arg = arg;
+    for (int i = 0; i < pool->threads; i++) {
+        pool->queues[i].next = tasks * i / pool->threads;
+        pool->queues[i].end = tasks * (i + 1) / pool->threads;
+    }
+    pool->active = pool->threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    list_pool_drain(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->active) pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->run_lock);
+}
+
+static ListPool *list_pool_shared;
+static pthread_once_t list_pool_shared_once = PTHREAD_ONCE_INIT;
+
+static void list_pool_shared_init(void)
+{
+    list_pool_shared = list_pool_new(0);
+}
+
+/* The pool used when a parallel call is passed NULL, sized to the CPUs. */
+static inline ListPool *list_pool_default(void)
+{
+    pthread_once(&list_pool_shared_once, list_pool_shared_init);
+    return list_pool_shared;
+}
+
+/* Lowers *target to value if value is smaller. */
+static inline void list_atomic_min(_Atomic ssize_t *target, ssize_t value)
+{
+    ssize_t seen = atomic_load(target);
+    while (value < seen && !atomic_compare_exchange_weak(target, &seen, value))
+        ;
+}
+
+/* Must follow IMPORT_LIST(T, L). */
+#define IMPORT_LIST_PARALLEL(T, L)                                             \
+typedef int (*range_func_##L)(L, ssize_t, ssize_t, void*);                     \
+                                                                               \
+typedef struct {                                                               \
+    T *src;                                                                    \
+    T *dst;                                                                    \
+    ssize_t n;                                                                 \
+    ssize_t chunks;                                                            \
+    ssize_t width;                                                             \
+    ssize_t parts;                                                             \
+    compare_func cmp;                                                          \
+} L##_psort_job;                                                               \
+                                                                               \
+static inline ssize_t L##_psort_bound(L##_psort_job *job, ssize_t chunk)       \
+{                                                                              \
+    if (chunk > job->chunks) chunk = job->chunks;                              \
+    return job->n * chunk / job->chunks;                                       \
+}                                                                              \
+                                                                               \
+static inline void L##_psort_chunk(void *arg, ssize_t task)                    \
+{                                                                              \
+    L##_psort_job *job = (L##_psort_job *) arg;                                \
+    ssize_t lo = L##_psort_bound(job, task);                                   \
+    ssize_t n = L##_psort_bound(job, task + 1) - lo;                           \
+    L##_cmp_introsort(job->src + lo, n, list_sort_depth(n), job->cmp);         \
+}                                                                              \
+                                                                               \
+/* How many of the first k merged elements come from a (stable co-rank). */    \
+static inline ssize_t L##_psort_corank(const T *a, ssize_t na, const T *b,     \
+                                       ssize_t nb, ssize_t k,                  \
+                                       compare_func cmp)                       \
+{                                                                              \
+    ssize_t lo = k > nb ? k - nb : 0;                                          \
+    ssize_t hi = k < na ? k : na;                                              \
+    while (lo < hi) {                                                          \
+        ssize_t i = lo + (hi - lo) / 2;                                        \
+        if (cmp(&b[k - i - 1], &a[i]) < 0) hi = i;                             \
+        else lo = i + 1;                                                       \
+    }                                                                          \
+    return lo;                                                                 \
+}                                                                              \
+                                                                               \
+static inline void L##_psort_merge(void *arg, ssize_t task)                    \
+{                                                                              \
+    L##_psort_job *job = (L##_psort_job *) arg;                                \
+    ssize_t pair = task / job->parts;                                          \
+    ssize_t part = task % job->parts;                                          \
+    ssize_t lo = L##_psort_bound(job, pair * 2 * job->width);                  \
+    ssize_t mid = L##_psort_bound(job, pair * 2 * job->width + job->width);    \
+    ssize_t hi = L##_psort_bound(job, (pair + 1) * 2 * job->width);            \
+    const T *a = job->src + lo;                                                \
+    const T *b = job->src + mid;                                               \
+    ssize_t na = mid - lo;                                                     \
+    ssize_t nb = hi - mid;                                                     \
+    ssize_t k0 = (na + nb) * part / job->parts;                                \
+    ssize_t k1 = (na + nb) * (part + 1) / job->parts;                          \
+    ssize_t i = L##_psort_corank(a, na, b, nb, k0, job->cmp);                  \
+    ssize_t j = k0 - i;                                                        \
+    ssize_t i1 = L##_psort_corank(a, na, b, nb, k1, job->cmp);                 \
+    ssize_t j1 = k1 - i1;                                                      \
+    T *out = job->dst + lo + k0;                                               \
+                                                                               \
+    while (i < i1 && j < j1) {                                                 \
+        if (job->cmp(&b[j], &a[i]) < 0) *out++ = b[j++];                       \
+        else *out++ = a[i++];                                                  \
+    }                                                                          \
+    if (i < i1) memcpy(out, &a[i], (i1 - i) * sizeof(T));                      \
+    if (j < j1) memcpy(out, &b[j], (j1 - j) * sizeof(T));                      \
+}                                                                              \
+                                                                               \
+/*                                                                             \
+ * Sorts [left, right] by sorting one chunk per worker and then merging        \
+ * pairs of runs, each merge split across workers by co-ranking. Needs a       \
+ * scratch copy of the range, so it can return MEMORY_ALLOCATION_ERR.          \
+ */                                                                            \
+static inline int L##_psort(L list, ssize_t left, ssize_t right,               \
+                            compare_func cmp, ListPool *pool)                  \
+{                                                                              \
+    if (!list || !cmp) return UNINITIALISED_ARRAY;                             \
+    if (left < 0 || right >= list->size) return INDEX_OUT_OF_RANGE;            \
+    if (!pool) pool = list_pool_default();                                     \
+    ssize_t n = right - left + 1;                                              \
+    if (!pool || pool->threads == 1 || n < LIST_PARALLEL_CUTOFF) {             \
+        L##_sort(list, left, right, cmp);                                      \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    T *tmp = (T *) malloc(n * sizeof(T));                                      \
+    if (!tmp) return MEMORY_ALLOCATION_ERR;                                    \
+                                                                               \
+    L##_psort_job job;                                                         \
+    job.src = &list->data[left];                                               \
+    job.dst = tmp;                                                             \
+    job.n = n;                                                                 \
+    job.chunks = pool->threads;                                                \
+    job.cmp = cmp;                                                             \
+    list_pool_run(pool, L##_psort_chunk, &job, job.chunks);                    \
+                                                                               \
+    for (job.width = 1; job.width < job.chunks; job.width *= 2) {              \
+        ssize_t pairs = (job.chunks + 2 * job.width - 1) / (2 * job.width);    \
+        job.parts = pool->threads / pairs;                                     \
+        if (job.parts < 1) job.parts = 1;                                      \
+        list_pool_run(pool, L##_psort_merge, &job, pairs * job.parts);         \
+        T *swap = job.src;                                                     \
+        job.src = job.dst;                                                     \
+        job.dst = swap;                                                        \
+    }                                                                          \
+    if (job.src != &list->data[left])                                          \
+        memcpy(&list->data[left], job.src, n * sizeof(T));                     \
+    free(tmp);                                                                 \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+typedef struct {                                                               \
+    L list;                                                                    \
+    T element;                                                                 \
+    compare_func cmp;                                                          \
+    _Atomic ssize_t found;                                                     \
+} L##_pfind_job;                                                               \
+                                                                               \
+static inline void L##_pfind_chunk(void *arg, ssize_t task)                    \
+{                                                                              \
+    L##_pfind_job *job = (L##_pfind_job *) arg;                                \
+    ssize_t lo = task * LIST_PARALLEL_GRAIN;                                   \
+    ssize_t hi = lo + LIST_PARALLEL_GRAIN;                                     \
+    if (hi > job->list->size) hi = job->list->size;                            \
+    if (lo >= atomic_load_explicit(&job->found, memory_order_relaxed)) return; \
+                                                                               \
+    for (ssize_t i = lo; i < hi; i++) {                                        \
+        if (job->cmp(&job->list->data[i], &job->element) == 0) {               \
+            list_atomic_min(&job->found, i);                                   \
+            return;                                                            \
+        }                                                                      \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+/*                                                                             \
+ * Returns the lowest index holding element, or -1. Chunks that start past     \
+ * an index already found are skipped.                                         \
+ */                                                                            \
+static inline ssize_t L##_pfind(L list, T element, compare_func cmp,           \
+                                ListPool *pool)                                \
+{                                                                              \
+    if (!list || !cmp) return -1;                                              \
+    if (!pool) pool = list_pool_default();                                     \
+    ssize_t n = list->size;                                                    \
+    if (!pool || pool->threads == 1 || n < LIST_PARALLEL_CUTOFF)               \
+        return L##_find(list, element, cmp);                                   \
+                                                                               \
+    L##_pfind_job job;                                                         \
+    job.list = list;                                                           \
+    job.element = element;                                                     \
+    job.cmp = cmp;                                                             \
+    atomic_init(&job.found, n);                                                \
+    list_pool_run(pool, L##_pfind_chunk, &job,                                 \
+                  (n + LIST_PARALLEL_GRAIN - 1) / LIST_PARALLEL_GRAIN);        \
+                                                                               \
+    ssize_t found = atomic_load(&job.found);                                   \
+    return found < n ? found : -1;                                             \
+}                                                                              \
+                                                                               \
+typedef struct {                                                               \
+    L list;                                                                    \
+    range_func_##L func;                                                       \
+    void *ctx;                                                                 \
+    ssize_t grain;                                                             \
+    _Atomic int retCode;                                                       \
+} L##_pforeach_job;                                                            \
+                                                                               \
+static inline void L##_pforeach_chunk(void *arg, ssize_t task)                 \
+{                                                                              \
+    L##_pforeach_job *job = (L##_pforeach_job *) arg;                          \
+    if (atomic_load_explicit(&job->retCode, memory_order_relaxed)) return;     \
+    ssize_t lo = task * job->grain;                                            \
+    ssize_t hi = lo + job->grain;                                              \
+    if (hi > job->list->size) hi = job->list->size;                            \
+                                                                               \
+    int retCode = job->func(job->list, lo, hi, job->ctx);                      \
+    if (retCode) {                                                             \
+        int expected = 0;                                                      \
+        atomic_compare_exchange_strong(&job->retCode, &expected, retCode);     \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+/*                                                                             \
+ * Calls func(list, begin, end, ctx) over consecutive [begin, end) ranges of   \
+ * at most grain elements (LIST_PARALLEL_GRAIN if grain < 1). Stops handing    \
+ * out ranges once a call returns non-zero and returns that code.              \
+ */                                                                            \
+static inline int L##_pforeach(L list, range_func_##L func, void *ctx,         \
+                               ssize_t grain, ListPool *pool)                  \
+{                                                                              \
+    if (!list || !list->data || !func) return UNINITIALISED_ARRAY;             \
+    if (!pool) pool = list_pool_default();                                     \
+    ssize_t n = list->size;                                                    \
+    if (!pool || pool->threads == 1 || n < LIST_PARALLEL_CUTOFF)               \
+        return func(list, 0, n, ctx);                                          \
+                                                                               \
+    L##_pforeach_job job;                                                      \
+    job.list = list;                                                           \
+    job.func = func;                                                           \
+    job.ctx = ctx;                                                             \
+    job.grain = grain < 1 ? LIST_PARALLEL_GRAIN : grain;                       \
+    atomic_init(&job.retCode, 0);                                              \
+    list_pool_run(pool, L##_pforeach_chunk, &job,                              \
+                  (n + job.grain - 1) / job.grain);                            \
+    return atomic_load(&job.retCode);                                          \
+}
+
+#endif //DATASTRUCTURES_LIST_PARALLEL_H
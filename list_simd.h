@@ -0,0 +1,326 @@
+// Vectorised search and reduction kernels for lists of arithmetic types.
+//
+// The kernels are written with GCC/Clang vector extensions, so one macro
+// covers every element type. On x86 each kernel is compiled twice, once for
+// the SSE2 baseline and once for AVX2, and the AVX2 copy is picked at run time
+// when the CPU has it. Other compilers get plain scalar loops.
+
+#ifndef DATASTRUCTURES_LIST_SIMD_H
+#define DATASTRUCTURES_LIST_SIMD_H
+
+#include "list.h"
+
+/* Bytes per vector; AVX2 registers, or two SSE2 registers. */
+#define LIST_SIMD_WIDTH 32
+
+#if defined(__GNUC__)
+#define LIST_SIMD_VECTOR 1
+#if defined(__x86_64__) || defined(__i386__)
+#define LIST_SIMD_DISPATCH 1
+#endif
+#endif
+
+/* True if any lane of a LIST_SIMD_WIDTH byte mask vector is set. */
+static inline int list_simd_any(const void *mask)
+{
+    uint64_t w[LIST_SIMD_WIDTH / 8];
+    memcpy(w, mask, sizeof(w));
+    return (w[0] | w[1] | w[2] | w[3]) != 0;
+}
+
+static inline int list_simd_has_avx2(void)
+{
+#ifdef LIST_SIMD_DISPATCH
+    /* Reads features the runtime detected at startup, so it is thread safe. */
+    return __builtin_cpu_supports("avx2") ? 1 : 0;
+#else
+    return 0;
+#endif
+}
+
+/* Names the instruction set the kernels run with on this machine. */
+static inline const char *list_simd_isa(void)
+{
+#if defined(LIST_SIMD_DISPATCH)
+    return list_simd_has_avx2() ? "avx2" : "sse2";
+#elif defined(LIST_SIMD_VECTOR)
+    return "vector";
+#else
+    return "scalar";
+#endif
+}
+
+#ifdef LIST_SIMD_VECTOR
+
+/*
+ * Generates the kernels for one target. ATTR is a function attribute such as
+ * __attribute__((target("avx2"))), or empty for the baseline.
+ */
+#define LIST_SIMD_KERNELS(T, L, S, SFX, ATTR)                                  \
+static inline ATTR ssize_t L##_find_eq_##SFX(const T *data, ssize_t n, T x)    \
+{                                                                              \
+    const ssize_t w = LIST_SIMD_WIDTH / sizeof(T);                             \
+    L##_vec vx = (L##_vec) {0} + x;                                            \
+    ssize_t i = 0;                                                             \
+    for (; i + 4 * w <= n; i += 4 * w) {                                       \
+        L##_vec a, b, c, d;                                                    \
+        memcpy(&a, data + i, sizeof(a));                                       \
+        memcpy(&b, data + i + w, sizeof(b));                                   \
+        memcpy(&c, data + i + 2 * w, sizeof(c));                               \
+        memcpy(&d, data + i + 3 * w, sizeof(d));                               \
+        __typeof__(a == vx) m = (a == vx) | (b == vx) | (c == vx) | (d == vx); \
+        if (list_simd_any(&m)) break;                                          \
+    }                                                                          \
+    for (; i < n; i++)                                                         \
+        if (data[i] == x) return i;                                            \
+    return -1;                                                                 \
+}                                                                              \
+                                                                               \
+static inline ATTR ssize_t L##_count_eq_##SFX(const T *data, ssize_t n, T x)   \
+{                                                                              \
+    const ssize_t w = LIST_SIMD_WIDTH / sizeof(T);                             \
+    L##_vec vx = (L##_vec) {0} + x;                                            \
+    ssize_t count = 0;                                                         \
+    ssize_t i = 0;                                                             \
+    while (i + 2 * w <= n) {                                                   \
+        /* Lanes may be a single byte wide, so flush before they wrap. */      \
+        __typeof__(vx == vx) acc = (vx == vx) ^ (vx == vx);                    \
+        for (int k = 0; k < 32 && i + 2 * w <= n; k++, i += 2 * w) {           \
+            L##_vec a, b;                                                      \
+            memcpy(&a, data + i, sizeof(a));                                   \
+            memcpy(&b, data + i + w, sizeof(b));                               \
+            acc -= a == vx;                                                    \
+            acc -= b == vx;                                                    \
+        }                                                                      \
+        for (ssize_t j = 0; j < w; j++) count += acc[j];                       \
+    }                                                                          \
+    for (; i < n; i++) count += data[i] == x;                                  \
+    return count;                                                              \
+}                                                                              \
+                                                                               \
+static inline ATTR T L##_min_##SFX(const T *data, ssize_t n)                   \
+{                                                                              \
+    const ssize_t w = LIST_SIMD_WIDTH / sizeof(T);                             \
+    T best = data[0];                                                          \
+    ssize_t i = 0;                                                             \
+    if (n >= w) {                                                              \
+        L##_vec acc;                                                           \
+        memcpy(&acc, data, sizeof(acc));                                       \
+        for (i = w; i + w <= n; i += w) {                                      \
+            L##_vec a;                                                         \
+            memcpy(&a, data + i, sizeof(a));                                   \
+            __typeof__(a < acc) m = a < acc;                                   \
+            acc = (L##_vec) (((__typeof__(m)) a & m)                           \
+                             | ((__typeof__(m)) acc & ~m));                    \
+        }                                                                      \
+        best = acc[0];                                                         \
+        for (ssize_t j = 1; j < w; j++) if (acc[j] < best) best = acc[j];      \
+    }                                                                          \
+    for (; i < n; i++) if (data[i] < best) best = data[i];                     \
+    return best;                                                               \
+}                                                                              \
+                                                                               \
+static inline ATTR T L##_max_##SFX(const T *data, ssize_t n)                   \
+{                                                                              \
+    const ssize_t w = LIST_SIMD_WIDTH / sizeof(T);                             \
+    T best = data[0];                                                          \
+    ssize_t i = 0;                                                             \
+    if (n >= w) {                                                              \
+        L##_vec acc;                                                           \
+        memcpy(&acc, data, sizeof(acc));                                       \
+        for (i = w; i + w <= n; i += w) {                                      \
+            L##_vec a;                                                         \
+            memcpy(&a, data + i, sizeof(a));                                   \
+            __typeof__(a > acc) m = a > acc;                                   \
+            acc = (L##_vec) (((__typeof__(m)) a & m)                           \
+                             | ((__typeof__(m)) acc & ~m));                    \
+        }                                                                      \
+        best = acc[0];                                                         \
+        for (ssize_t j = 1; j < w; j++) if (acc[j] > best) best = acc[j];      \
+    }                                                                          \
+    for (; i < n; i++) if (data[i] > best) best = data[i];                     \
+    return best;                                                               \
+}                                                                              \
+                                                                               \
+static inline ATTR S L##_sum_##SFX(const T *data, ssize_t n)                   \
+{                                                                              \
+    /* Lanes are widened to S first, so a step covers one S vector. */         \
+    const ssize_t w = LIST_SIMD_WIDTH / sizeof(S);                             \
+    L##_sum_vec acc0 = {0};                                                    \
+    L##_sum_vec acc1 = {0};                                                    \
+    L##_sum_vec acc2 = {0};                                                    \
+    L##_sum_vec acc3 = {0};                                                    \
+    ssize_t i = 0;                                                             \
+    for (; i + 4 * w <= n; i += 4 * w) {                                       \
+        L##_sum_src a, b, c, d;                                                \
+        memcpy(&a, data + i, sizeof(a));                                       \
+        memcpy(&b, data + i + w, sizeof(b));                                   \
+        memcpy(&c, data + i + 2 * w, sizeof(c));                               \
+        memcpy(&d, data + i + 3 * w, sizeof(d));                               \
+        acc0 += __builtin_convertvector(a, L##_sum_vec);                       \
+        acc1 += __builtin_convertvector(b, L##_sum_vec);                       \
+        acc2 += __builtin_convertvector(c, L##_sum_vec);                       \
+        acc3 += __builtin_convertvector(d, L##_sum_vec);                       \
+    }                                                                          \
+    acc0 += acc1 + acc2 + acc3;                                                \
+    S sum = 0;                                                                 \
+    for (ssize_t j = 0; j < w; j++) sum += acc0[j];                            \
+    for (; i < n; i++) sum += (S) data[i];                                     \
+    return sum;                                                                \
+}
+
+/* Generates a predicate search for one target; see IMPORT_LIST_SIMD_FIND_IF. */
+#define LIST_SIMD_FIND_IF_KERNEL(T, L, NAME, PRED, SFX, ATTR)                  \
+static inline ATTR ssize_t L##_find_##NAME##_##SFX(const T *data, ssize_t n)   \
+{                                                                              \
+    const ssize_t w = LIST_SIMD_WIDTH / sizeof(T);                             \
+    ssize_t i = 0;                                                             \
+    for (; i + 2 * w <= n; i += 2 * w) {                                       \
+        L##_vec a, b;                                                          \
+        memcpy(&a, data + i, sizeof(a));                                       \
+        memcpy(&b, data + i + w, sizeof(b));                                   \
+        __typeof__(a == a) m = (PRED(a)) | (PRED(b));                          \
+        if (list_simd_any(&m)) break;                                          \
+    }                                                                          \
+    for (; i < n; i++)                                                         \
+        if (PRED(data[i])) return i;                                           \
+    return -1;                                                                 \
+}
+
+#else
+
+#define LIST_SIMD_KERNELS(T, L, S, SFX, ATTR)                                  \
+static inline ssize_t L##_find_eq_##SFX(const T *data, ssize_t n, T x)         \
+{                                                                              \
+    for (ssize_t i = 0; i < n; i++) if (data[i] == x) return i;                \
+    return -1;                                                                 \
+}                                                                              \
+                                                                               \
+static inline ssize_t L##_count_eq_##SFX(const T *data, ssize_t n, T x)        \
+{                                                                              \
+    ssize_t count = 0;                                                         \
+    for (ssize_t i = 0; i < n; i++) count += data[i] == x;                     \
+    return count;                                                              \
+}                                                                              \
+                                                                               \
+static inline T L##_min_##SFX(const T *data, ssize_t n)                        \
+{                                                                              \
+    T best = data[0];                                                          \
+    for (ssize_t i = 1; i < n; i++) if (data[i] < best) best = data[i];        \
+    return best;                                                               \
+}                                                                              \
+                                                                               \
+static inline T L##_max_##SFX(const T *data, ssize_t n)                        \
+{                                                                              \
+    T best = data[0];                                                          \
+    for (ssize_t i = 1; i < n; i++) if (data[i] > best) best = data[i];        \
+    return best;                                                               \
+}                                                                              \
+                                                                               \
+static inline S L##_sum_##SFX(const T *data, ssize_t n)                        \
+{                                                                              \
+    S sum = 0;                                                                 \
+    for (ssize_t i = 0; i < n; i++) sum += (S) data[i];                        \
+    return sum;                                                                \
+}
+
+#define LIST_SIMD_FIND_IF_KERNEL(T, L, NAME, PRED, SFX, ATTR)                  \
+static inline ssize_t L##_find_##NAME##_##SFX(const T *data, ssize_t n)        \
+{                                                                              \
+    for (ssize_t i = 0; i < n; i++) if (PRED(data[i])) return i;               \
+    return -1;                                                                 \
+}
+
+#endif
+
+#ifdef LIST_SIMD_DISPATCH
+#define LIST_SIMD_AVX2 __attribute__((target("avx2")))
+#define LIST_SIMD_CALL(L, KERNEL, ...)                                         \
+    (list_simd_has_avx2() ? L##_##KERNEL##_avx2(__VA_ARGS__)                   \
+                          : L##_##KERNEL##_base(__VA_ARGS__))
+#define LIST_SIMD_ALL_KERNELS(T, L, S)                                         \
+    LIST_SIMD_KERNELS(T, L, S, avx2, LIST_SIMD_AVX2)                           \
+    LIST_SIMD_KERNELS(T, L, S, base, )
+#define LIST_SIMD_ALL_FIND_IF(T, L, NAME, PRED)                                \
+    LIST_SIMD_FIND_IF_KERNEL(T, L, NAME, PRED, avx2, LIST_SIMD_AVX2)           \
+    LIST_SIMD_FIND_IF_KERNEL(T, L, NAME, PRED, base, )
+#else
+#define LIST_SIMD_CALL(L, KERNEL, ...) L##_##KERNEL##_base(__VA_ARGS__)
+#define LIST_SIMD_ALL_KERNELS(T, L, S) LIST_SIMD_KERNELS(T, L, S, base, )
+#define LIST_SIMD_ALL_FIND_IF(T, L, NAME, PRED)                                \
+    LIST_SIMD_FIND_IF_KERNEL(T, L, NAME, PRED, base, )
+#endif
+
+#ifdef LIST_SIMD_VECTOR
+#define LIST_SIMD_TYPES(T, L, S)                                               \
+typedef T L##_vec __attribute__((vector_size(LIST_SIMD_WIDTH)));               \
+typedef S L##_sum_vec __attribute__((vector_size(LIST_SIMD_WIDTH)));           \
+typedef T L##_sum_src                                                          \
+    __attribute__((vector_size(sizeof(T) * (LIST_SIMD_WIDTH / sizeof(S)))));
+#else
+#define LIST_SIMD_TYPES(T, L, S)
+#endif
+
+/*
+ * Generates find_eq, count_eq, min, max and sum for a list of arithmetic T.
+ * Must follow IMPORT_LIST(T, L). S is the type sum accumulates in, such as
+ * int64_t for an int list, and must be at least as wide as T. Floating
+ * point sums are added in a different order from a plain loop, and min/max
+ * leave the result unspecified if the list holds NaNs.
+ */
+#define IMPORT_LIST_SIMD(T, L, S)                                              \
+LIST_SIMD_TYPES(T, L, S)                                                       \
+LIST_SIMD_ALL_KERNELS(T, L, S)                                                 \
+                                                                               \
+/* Returns the lowest index holding element, or -1. */                         \
+static inline ssize_t L##_find_eq(L list, T element)                           \
+{                                                                              \
+    if (!list || !list->data) return -1;                                       \
+    return LIST_SIMD_CALL(L, find_eq, list->data, list->size, element);        \
+}                                                                              \
+                                                                               \
+static inline ssize_t L##_count_eq(L list, T element)                          \
+{                                                                              \
+    if (!list || !list->data) return 0;                                        \
+    return LIST_SIMD_CALL(L, count_eq, list->data, list->size, element);       \
+}                                                                              \
+                                                                               \
+static inline int L##_min(L list, T *result)                                   \
+{                                                                              \
+    if (!list || !list->data) return UNINITIALISED_ARRAY;                      \
+    if (!list->size) return INDEX_OUT_OF_RANGE;                                \
+    *result = LIST_SIMD_CALL(L, min, list->data, list->size);                  \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+static inline int L##_max(L list, T *result)                                   \
+{                                                                              \
+    if (!list || !list->data) return UNINITIALISED_ARRAY;                      \
+    if (!list->size) return INDEX_OUT_OF_RANGE;                                \
+    *result = LIST_SIMD_CALL(L, max, list->data, list->size);                  \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+static inline S L##_sum(L list)                                                \
+{                                                                              \
+    if (!list || !list->data) return 0;                                        \
+    return LIST_SIMD_CALL(L, sum, list->data, list->size);                     \
+}
+
+/*
+ * Generates L##_find_##NAME(list), returning the lowest index for which
+ * PRED(x) holds, or -1. Must follow IMPORT_LIST_SIMD(T, L, S). PRED is applied
+ * to whole vectors as well as to single elements, so it may only use
+ * arithmetic, comparison and bitwise operators: write
+ * ((x) >= lo) & ((x) < hi) rather than using &&.
+ */
+#define IMPORT_LIST_SIMD_FIND_IF(T, L, NAME, PRED)                             \
+LIST_SIMD_ALL_FIND_IF(T, L, NAME, PRED)                                        \
+                                                                               \
+static inline ssize_t L##_find_##NAME(L list)                                  \
+{                                                                              \
+    if (!list || !list->data) return -1;                                       \
+    return LIST_SIMD_CALL(L, find_##NAME, list->data, list->size);             \
+}
+
+#endif //DATASTRUCTURES_LIST_SIMD_H